@@ -1,5 +1,6 @@
 // https://cs.lmu.edu/~ray/notes/openglexamples/
-// g++ litsolids.cpp -lX11 -lGL -lGLU -lglut -g -Wall -O2 -o r.exe
+// g++ T2.cpp -lX11 -lGL -lGLU -lglut -lEGL -pthread -g -Wall -O2 -o r.exe
+// (com -DPENGUIN_ALLOC_COUNTER=1 para usar --check-allocs)
 //
 // Este programa mostra três objetos ciano iluminados com uma única
 // fonte de luz amarela. Ele ilustra vários dos parâmetros de iluminação.
@@ -7,15 +8,39 @@
 #ifdef __APPLE_CC__
 #include <GLUT/glut.h>
 #else
+#define GL_GLEXT_PROTOTYPES
 #include <GL/glut.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glx.h>
+#define PENGUIN_HAS_EGL 1
+#define PENGUIN_HAS_GLX 1
 #endif
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <vector>
+#include <algorithm>
 #include <ctime>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <stddef.h>
 #include <iostream>
+#include <new>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -26,21 +51,46 @@
 // ===================================================================
 
 // --- Constantes do Jogo ---
-float GAME_DURATION = 300.0f;       // Duração total do jogo em segundos
-float BABY_ENERGY_MAX = 60.0f;      // Energia/tempo máximo para o pinguim bebê
-float PENGUIN_SPEED = 2.5f;         // Velocidade de movimento do pinguim mãe
-float ROTATION_SPEED = 120.0f;       // Velocidade de rotação do pinguim mãe
-float ICE_PLATFORM_SIZE = 10.0f;    // A largura e profundidade da plataforma de gelo
-int MAX_FISH = 5;                   // Número máximo de peixes permitidos na tela
-int MAX_HOLES = 8;                  // Número máximo de buracos permitidos na tela
-
-// --- Variáveis de Estado do Jogo ---
-int gameState;                      // 0: Jogando, 1: Vitória, 2: Derrota
-int cameraSelected;                 // Qual visão de câmera está ativa
-float gameTime;                     // Tempo de jogo decorrido
-float babyEnergyTime;               // Tempo restante para a energia do bebê
-float fishSpawnTimer;               // Timer para controlar quando novos peixes aparecem
-float holeSpawnTimer;               // Timer para controlar quando novos buracos aparecem
+// Parâmetros ajustáveis de um jogo. Cada GameWorld tem a sua cópia, então jogos
+// com parâmetros diferentes podem rodar lado a lado (--sweep)
+struct GameParams {
+    float gameDuration;             // Duração total do jogo em segundos
+    float babyEnergyMax;            // Energia/tempo máximo para o pinguim bebê
+    float penguinSpeed;             // Velocidade de movimento do pinguim mãe
+    float rotationSpeed;            // Velocidade de rotação do pinguim mãe
+    float icePlatformSize;          // A largura e profundidade da plataforma de gelo
+    int maxFish;                    // Número máximo de peixes permitidos na tela
+    int maxHoles;                   // Número máximo de buracos permitidos na tela
+    float fishSpawnInterval;        // Segundos entre o surgimento de dois peixes
+    float holeSpawnInterval;        // Segundos entre o surgimento de dois buracos
+    float holeLifetime;             // Segundos até um buraco se fechar (0 = nunca)
+};
+const GameParams DEFAULT_GAME_PARAMS = {300.0f, 60.0f, 2.5f, 120.0f, 10.0f, 5, 8, 5.0f, 8.0f, 0.0f};
+const float SIM_DELTA_TIME = 16.0f / 1000.0f; // Passo fixo da simulação em segundos
+
+// --- Ações de Controle do Pinguim Mãe ---
+// Usadas pelo núcleo da simulação para não depender dos códigos de tecla da GLUT
+enum PenguinAction {
+    ACTION_NONE = 0,
+    ACTION_FORWARD,
+    ACTION_BACKWARD,
+    ACTION_TURN_LEFT,
+    ACTION_TURN_RIGHT
+};
+
+// --- Teclas de Controle ---
+// Bits da máscara de teclas seguradas, lida uma vez por passo da simulação
+enum ControlKey {
+    CONTROL_FORWARD = 1,
+    CONTROL_BACKWARD = 2,
+    CONTROL_TURN_LEFT = 4,
+    CONTROL_TURN_RIGHT = 8
+};
+
+// --- Variáveis de Estado da Janela ---
+std::atomic<int> cameraSelected(0); // Qual visão de câmera está ativa (o reset da simulação a muda)
+int windowWidth = 1024;             // Tamanho atual da janela (ou do framebuffer fora da tela)
+int windowHeight = 768;
 
 // --- Structs para Objetos do Jogo ---
 // Estrutura para representar uma posição 3D
@@ -58,77 +108,1546 @@ struct Penguin {
     bool isBaby;
 };
 
-// Estrutura para armazenar o estado de um peixe
+// Estrutura com o estado de um peixe, montada a partir do pool para desenho
 struct Fish {
     Position pos;
-    bool active;
     float animationTime;
     float bobHeight;
+    float bobOffset;  // Deslocamento vertical atual, calculado em lote
+    float yaw;        // Giro atual em graus, calculado em lote
 };
 
-// Estrutura para armazenar o estado de um buraco
+// Estrutura com o estado de um buraco, montada a partir do pool para desenho
 struct Hole {
     Position pos;
     float radius;
-    bool active;
     float animationTime;
 };
 
+// --- Pool Genérico de Entidades (SoA) ---
+// Cada atributo fica em seu próprio vetor contíguo (coluna). As entidades ativas
+// ocupam sempre os índices densos [0, count), então laços de atualização e desenho
+// só visitam entidades vivas. Os slots dão um identificador estável para cada
+// entidade enquanto ela vive, e a lista livre torna spawn e despawn O(1).
+template <int NUM_COLUMNS>
+struct EntityPool {
+    std::vector<float> columns[NUM_COLUMNS]; // Atributos indexados pelo índice denso
+    std::vector<int> denseToSlot;            // Slot estável de cada entidade ativa
+    std::vector<int> slotToDense;            // Índice denso de cada slot (-1 se livre)
+    std::vector<int> freeSlots;              // Pilha de slots livres
+    int count;                               // Número de entidades ativas
+
+    // reset: Esvazia o pool e reserva espaço para capacity entidades.
+    void reset(int capacity) {
+        for (int c = 0; c < NUM_COLUMNS; ++c) columns[c].assign(capacity, 0.0f);
+        denseToSlot.assign(capacity, -1);
+        slotToDense.assign(capacity, -1);
+        freeSlots.resize(capacity);
+        for (int i = 0; i < capacity; ++i) freeSlots[i] = capacity - 1 - i;
+        count = 0;
+    }
+
+    // spawn: Ativa uma entidade e retorna seu índice denso, ou -1 se o pool estiver cheio.
+    int spawn() {
+        if (freeSlots.empty()) return -1;
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        int dense = count++;
+        denseToSlot[dense] = slot;
+        slotToDense[slot] = dense;
+        return dense;
+    }
+
+    // despawn: Desativa a entidade no índice denso movendo a última para o seu lugar.
+    void despawn(int dense) {
+        int last = --count;
+        int slot = denseToSlot[dense];
+        if (dense != last) {
+            for (int c = 0; c < NUM_COLUMNS; ++c) columns[c][dense] = columns[c][last];
+            denseToSlot[dense] = denseToSlot[last];
+            slotToDense[denseToSlot[dense]] = dense;
+        }
+        slotToDense[slot] = -1;
+        freeSlots.push_back(slot);
+    }
+
+    // column: Acesso direto a uma coluna para laços em lote.
+    float* column(int c) { return columns[c].data(); }
+    const float* column(int c) const { return columns[c].data(); }
+};
+
+// Colunas dos pools de peixes e buracos
+enum FishColumn { FISH_X, FISH_Y, FISH_Z, FISH_RADIUS, FISH_ANIMATION_TIME, FISH_BOB_HEIGHT, FISH_NUM_COLUMNS };
+enum HoleColumn { HOLE_X, HOLE_Y, HOLE_Z, HOLE_RADIUS, HOLE_ANIMATION_TIME, HOLE_NUM_COLUMNS };
+typedef EntityPool<FISH_NUM_COLUMNS> FishPool;
+typedef EntityPool<HOLE_NUM_COLUMNS> HolePool;
+
+// --- Grade Espacial Uniforme (broadphase de colisão) ---
+// Divide o plano XZ da plataforma em células quadradas. Cada célula guarda uma lista
+// duplamente encadeada de identificadores (slots do pool), de modo que inserir,
+// remover e mover uma entidade custa O(1) e uma consulta por raio só visita as
+// células cobertas pelo círculo. O teste exato continua sendo feito com checkCollision.
+struct SpatialGrid {
+    float cellSize;
+    float originX, originZ;      // Canto (-x, -z) da grade
+    int cellsX, cellsZ;
+    float maxRadius;             // Maior raio inserido, somado ao raio das consultas
+    std::vector<int> cellHead;   // Primeiro identificador de cada célula (-1 se vazia)
+    std::vector<int> next, prev; // Lista encadeada por identificador
+    std::vector<int> cellOf;     // Célula de cada identificador (-1 se fora da grade)
+
+    // reset: Cria uma grade vazia cobrindo worldSize x worldSize para capacity identificadores.
+    void reset(float worldSize, float cell, int capacity) {
+        cellSize = cell;
+        originX = originZ = -worldSize / 2.0f;
+        cellsX = cellsZ = (int)ceil(worldSize / cellSize);
+        if (cellsX < 1) cellsX = cellsZ = 1;
+        maxRadius = 0.0f;
+        cellHead.assign(cellsX * cellsZ, -1);
+        next.assign(capacity, -1);
+        prev.assign(capacity, -1);
+        cellOf.assign(capacity, -1);
+    }
+
+    // cellCoord: Converte uma coordenada do mundo em índice de célula, limitado à grade.
+    int cellCoord(float v, float origin, int cells) const {
+        int c = (int)floor((v - origin) / cellSize);
+        return c < 0 ? 0 : (c >= cells ? cells - 1 : c);
+    }
+
+    // insert: Coloca o identificador na célula que contém (x, z).
+    void insert(int id, float x, float z, float radius) {
+        int cell = cellCoord(z, originZ, cellsZ) * cellsX + cellCoord(x, originX, cellsX);
+        cellOf[id] = cell;
+        prev[id] = -1;
+        next[id] = cellHead[cell];
+        if (cellHead[cell] >= 0) prev[cellHead[cell]] = id;
+        cellHead[cell] = id;
+        if (radius > maxRadius) maxRadius = radius;
+    }
+
+    // remove: Retira o identificador da sua célula.
+    void remove(int id) {
+        int cell = cellOf[id];
+        if (cell < 0) return;
+        if (prev[id] >= 0) next[prev[id]] = next[id]; else cellHead[cell] = next[id];
+        if (next[id] >= 0) prev[next[id]] = prev[id];
+        cellOf[id] = -1;
+    }
+
+    // move: Atualiza a célula do identificador depois que a entidade se moveu.
+    void move(int id, float x, float z) {
+        int cell = cellCoord(z, originZ, cellsZ) * cellsX + cellCoord(x, originX, cellsX);
+        if (cell == cellOf[id]) return;
+        remove(id);
+        insert(id, x, z, 0.0f);
+    }
+
+    // query: Acrescenta em out os identificadores que podem estar a até radius de (x, z).
+    void query(float x, float z, float radius, std::vector<int>& out) const {
+        float r = radius + maxRadius;
+        int x0 = cellCoord(x - r, originX, cellsX), x1 = cellCoord(x + r, originX, cellsX);
+        int z0 = cellCoord(z - r, originZ, cellsZ), z1 = cellCoord(z + r, originZ, cellsZ);
+        for (int cz = z0; cz <= z1; ++cz) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                for (int id = cellHead[cz * cellsX + cx]; id >= 0; id = next[id]) {
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+};
+
+const float GRID_CELL_SIZE = 1.0f;  // Lado de cada célula da grade espacial
+const int PENGUIN_MOTHER_ID = 0;    // Identificadores dos pinguins na grade de pinguins
+const int PENGUIN_BABY_ID = 1;
+const float PENGUIN_HEIGHT = 0.48f;     // Altura do centro dos pinguins
+const float PENGUIN_RADIUS = 0.3f;      // Corpo dos pinguins: grade, borda da plataforma e alvo da entrega
+const float MOTHER_HOLE_REACH = 0.3f;   // Esfera da mãe contra os buracos
+const float MOTHER_FISH_REACH = 0.4f;   // Alcance do bico da mãe para pegar um peixe
+const float MOTHER_BABY_REACH = 0.5f;   // Alcance da mãe para entregar o peixe ao bebê
+
+// --- Malhas em Cache ---
+// Primitiva tesselada uma única vez e guardada numa display list
+struct Mesh {
+    std::vector<float> vertices;         // x, y, z por vértice
+    std::vector<float> normals;          // nx, ny, nz por vértice
+    std::vector<unsigned short> indices; // Triângulos
+    GLuint displayList;
+    GLuint vertexBuffer, normalBuffer, indexBuffer; // Cópia na GPU (instâncias e backend de shaders)
+    GLuint vertexArray;                  // Atributos 0 (posição) e 1 (normal), no backend de shaders
+};
+
+// Níveis de detalhe dos modelos, do mais fino (0) ao mais grosso
+const int NUM_LODS = 3;
+const int LOD_SPHERE_SLICES[NUM_LODS] = {20, 12, 6};
+const int LOD_TAIL_SLICES[NUM_LODS] = {12, 8, 4};
+const float LOD_MIN_PIXELS[NUM_LODS - 1] = {48.0f, 16.0f}; // Raio projetado mínimo dos níveis 0 e 1
+
+Mesh sphereMeshes[NUM_LODS];        // Esfera unitária em cada nível (elipsoides)
+Mesh eyeMesh;                       // Esfera unitária 10x10 (olhos)
+Mesh beakMesh;                      // Cone do bico
+Mesh tailMeshes[NUM_LODS];          // Cone da cauda do peixe em cada nível
+Mesh diskMesh;                      // Disco unitário (buracos)
+Mesh cubeMesh;                      // Cubo unitário (plataforma)
+Mesh fishModelMeshes[NUM_LODS];     // Corpo e cauda do peixe numa única malha, por nível
+int currentLod;                     // Nível do modelo sendo desenhado
+
+// --- Texto da Interface ---
+// Fonte bitmap 8x16 de largura fixa para os caracteres 32 a 126, uma linha de
+// bytes por linha de pixels (bit 7 = coluna da esquerda). Rasterizada do
+// DejaVu Sans Mono a 13 px, para não depender das fontes da GLUT.
+const int FONT_FIRST_CHAR = 32;
+const int FONT_NUM_CHARS = 95;
+const int FONT_CELL_WIDTH = 8;
+const int FONT_CELL_HEIGHT = 16;
+const int FONT_ATLAS_COLUMNS = 16;          // Glifos por linha do atlas
+const int FONT_ATLAS_SIZE = 128;            // Lado da textura do atlas
+const unsigned char FONT_GLYPHS[FONT_NUM_CHARS][FONT_CELL_HEIGHT] = {
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // espaço
+    {0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x10,0x10,0x00,0x00,0x00,0x00}, // !
+    {0x00,0x00,0x00,0x28,0x28,0x28,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // "
+    {0x00,0x00,0x12,0x12,0x16,0x7F,0x24,0x24,0xFE,0x28,0x48,0x48,0x00,0x00,0x00,0x00}, // #
+    {0x00,0x00,0x00,0x08,0x3E,0x49,0x48,0x38,0x0E,0x09,0x49,0x3E,0x08,0x08,0x00,0x00}, // $
+    {0x00,0x00,0x00,0x60,0x90,0x90,0x62,0x1C,0x66,0x09,0x09,0x06,0x00,0x00,0x00,0x00}, // %
+    {0x00,0x00,0x00,0x1C,0x20,0x20,0x30,0x49,0x4D,0x45,0x62,0x3D,0x00,0x00,0x00,0x00}, // &
+    {0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // '
+    {0x00,0x0C,0x08,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x08,0x08,0x04,0x00,0x00,0x00}, // (
+    {0x00,0x30,0x10,0x10,0x08,0x08,0x08,0x08,0x08,0x08,0x10,0x10,0x30,0x00,0x00,0x00}, // )
+    {0x00,0x00,0x00,0x08,0x49,0x3E,0x1C,0x6B,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // *
+    {0x00,0x00,0x00,0x00,0x10,0x10,0x10,0xFE,0x10,0x10,0x10,0x00,0x00,0x00,0x00,0x00}, // +
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x10,0x20,0x00,0x00}, // ,
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // -
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00}, // .
+    {0x00,0x00,0x00,0x02,0x04,0x04,0x08,0x08,0x18,0x10,0x10,0x20,0x20,0x40,0x00,0x00}, // /
+    {0x00,0x00,0x00,0x1C,0x22,0x41,0x41,0x49,0x41,0x41,0x22,0x1C,0x00,0x00,0x00,0x00}, // 0
+    {0x00,0x00,0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x3E,0x00,0x00,0x00,0x00}, // 1
+    {0x00,0x00,0x00,0x3E,0x43,0x01,0x01,0x02,0x0C,0x18,0x20,0x7F,0x00,0x00,0x00,0x00}, // 2
+    {0x00,0x00,0x00,0x3E,0x41,0x01,0x03,0x1C,0x03,0x01,0x43,0x3E,0x00,0x00,0x00,0x00}, // 3
+    {0x00,0x00,0x00,0x06,0x0A,0x1A,0x12,0x22,0x42,0x7F,0x02,0x02,0x00,0x00,0x00,0x00}, // 4
+    {0x00,0x00,0x00,0x7E,0x40,0x40,0x7C,0x03,0x01,0x01,0x43,0x3C,0x00,0x00,0x00,0x00}, // 5
+    {0x00,0x00,0x00,0x1E,0x21,0x40,0x5E,0x63,0x41,0x41,0x23,0x1E,0x00,0x00,0x00,0x00}, // 6
+    {0x00,0x00,0x00,0x7F,0x02,0x02,0x04,0x04,0x08,0x18,0x10,0x20,0x00,0x00,0x00,0x00}, // 7
+    {0x00,0x00,0x00,0x3E,0x41,0x41,0x41,0x3E,0x63,0x41,0x61,0x3E,0x00,0x00,0x00,0x00}, // 8
+    {0x00,0x00,0x00,0x3C,0x62,0x41,0x41,0x63,0x3D,0x01,0x42,0x3C,0x00,0x00,0x00,0x00}, // 9
+    {0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00}, // :
+    {0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x10,0x20,0x00,0x00}, // ;
+    {0x00,0x00,0x00,0x00,0x00,0x01,0x0E,0x70,0x70,0x0E,0x01,0x00,0x00,0x00,0x00,0x00}, // <
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x7F,0x00,0x00,0x7F,0x00,0x00,0x00,0x00,0x00,0x00}, // =
+    {0x00,0x00,0x00,0x00,0x00,0x40,0x38,0x07,0x07,0x38,0x40,0x00,0x00,0x00,0x00,0x00}, // >
+    {0x00,0x00,0x00,0x38,0x44,0x04,0x08,0x10,0x10,0x00,0x10,0x10,0x00,0x00,0x00,0x00}, // ?
+    {0x00,0x00,0x00,0x1E,0x33,0x21,0x47,0x49,0x49,0x49,0x47,0x20,0x30,0x1E,0x00,0x00}, // @
+    {0x00,0x00,0x00,0x08,0x14,0x14,0x14,0x22,0x22,0x3E,0x63,0x41,0x00,0x00,0x00,0x00}, // A
+    {0x00,0x00,0x00,0x7E,0x41,0x41,0x41,0x7E,0x41,0x41,0x41,0x7E,0x00,0x00,0x00,0x00}, // B
+    {0x00,0x00,0x00,0x1E,0x21,0x40,0x40,0x40,0x40,0x40,0x21,0x1E,0x00,0x00,0x00,0x00}, // C
+    {0x00,0x00,0x00,0x7C,0x42,0x41,0x41,0x41,0x41,0x41,0x42,0x7C,0x00,0x00,0x00,0x00}, // D
+    {0x00,0x00,0x00,0x7F,0x40,0x40,0x40,0x7F,0x40,0x40,0x40,0x7F,0x00,0x00,0x00,0x00}, // E
+    {0x00,0x00,0x00,0x7F,0x40,0x40,0x40,0x7F,0x40,0x40,0x40,0x40,0x00,0x00,0x00,0x00}, // F
+    {0x00,0x00,0x00,0x1E,0x21,0x40,0x40,0x43,0x41,0x41,0x21,0x1E,0x00,0x00,0x00,0x00}, // G
+    {0x00,0x00,0x00,0x41,0x41,0x41,0x41,0x7F,0x41,0x41,0x41,0x41,0x00,0x00,0x00,0x00}, // H
+    {0x00,0x00,0x00,0x7C,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x7C,0x00,0x00,0x00,0x00}, // I
+    {0x00,0x00,0x00,0x1C,0x04,0x04,0x04,0x04,0x04,0x04,0x44,0x38,0x00,0x00,0x00,0x00}, // J
+    {0x00,0x00,0x00,0x42,0x44,0x48,0x50,0x70,0x48,0x44,0x44,0x42,0x00,0x00,0x00,0x00}, // K
+    {0x00,0x00,0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x7F,0x00,0x00,0x00,0x00}, // L
+    {0x00,0x00,0x00,0x63,0x63,0x55,0x55,0x55,0x49,0x41,0x41,0x41,0x00,0x00,0x00,0x00}, // M
+    {0x00,0x00,0x00,0x61,0x61,0x51,0x51,0x49,0x45,0x45,0x43,0x43,0x00,0x00,0x00,0x00}, // N
+    {0x00,0x00,0x00,0x1C,0x22,0x41,0x41,0x41,0x41,0x41,0x22,0x1C,0x00,0x00,0x00,0x00}, // O
+    {0x00,0x00,0x00,0x7E,0x43,0x41,0x41,0x43,0x7E,0x40,0x40,0x40,0x00,0x00,0x00,0x00}, // P
+    {0x00,0x00,0x00,0x1C,0x22,0x41,0x41,0x41,0x41,0x41,0x23,0x1E,0x06,0x02,0x00,0x00}, // Q
+    {0x00,0x00,0x00,0x7E,0x43,0x41,0x41,0x7E,0x42,0x41,0x41,0x40,0x00,0x00,0x00,0x00}, // R
+    {0x00,0x00,0x00,0x3E,0x61,0x40,0x60,0x3E,0x03,0x01,0x43,0x3E,0x00,0x00,0x00,0x00}, // S
+    {0x00,0x00,0x00,0xFE,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // T
+    {0x00,0x00,0x00,0x41,0x41,0x41,0x41,0x41,0x41,0x41,0x41,0x3E,0x00,0x00,0x00,0x00}, // U
+    {0x00,0x00,0x00,0x41,0x63,0x22,0x22,0x22,0x14,0x14,0x14,0x08,0x00,0x00,0x00,0x00}, // V
+    {0x00,0x00,0x00,0x81,0x81,0x81,0x5A,0x5A,0x5A,0x66,0x66,0x66,0x00,0x00,0x00,0x00}, // W
+    {0x00,0x00,0x00,0x63,0x22,0x14,0x1C,0x08,0x14,0x36,0x22,0x41,0x00,0x00,0x00,0x00}, // X
+    {0x00,0x00,0x00,0x82,0x44,0x28,0x28,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // Y
+    {0x00,0x00,0x00,0x7F,0x03,0x06,0x04,0x08,0x10,0x30,0x60,0x7F,0x00,0x00,0x00,0x00}, // Z
+    {0x00,0x1C,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x1C,0x00,0x00,0x00}, // [
+    {0x00,0x00,0x00,0x40,0x20,0x20,0x10,0x10,0x18,0x08,0x08,0x04,0x04,0x02,0x00,0x00}, // barra invertida
+    {0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x38,0x00,0x00,0x00}, // ]
+    {0x00,0x00,0x00,0x10,0x28,0x44,0xC6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // ^
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x00}, // _
+    {0x00,0x00,0x10,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // `
+    {0x00,0x00,0x00,0x00,0x00,0x1C,0x22,0x02,0x3E,0x42,0x46,0x3A,0x00,0x00,0x00,0x00}, // a
+    {0x00,0x40,0x40,0x40,0x40,0x7C,0x66,0x42,0x42,0x42,0x66,0x7C,0x00,0x00,0x00,0x00}, // b
+    {0x00,0x00,0x00,0x00,0x00,0x1C,0x22,0x40,0x40,0x40,0x22,0x1C,0x00,0x00,0x00,0x00}, // c
+    {0x00,0x02,0x02,0x02,0x02,0x3E,0x66,0x42,0x42,0x42,0x66,0x3E,0x00,0x00,0x00,0x00}, // d
+    {0x00,0x00,0x00,0x00,0x00,0x3C,0x66,0x42,0x7E,0x40,0x62,0x3C,0x00,0x00,0x00,0x00}, // e
+    {0x00,0x0C,0x10,0x10,0x10,0x7C,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x00,0x00}, // f
+    {0x00,0x00,0x00,0x00,0x00,0x3E,0x66,0x42,0x42,0x42,0x66,0x3A,0x02,0x22,0x1C,0x00}, // g
+    {0x00,0x40,0x40,0x40,0x40,0x5C,0x62,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00,0x00}, // h
+    {0x00,0x10,0x00,0x00,0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x7C,0x00,0x00,0x00,0x00}, // i
+    {0x00,0x08,0x00,0x00,0x00,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x70,0x00}, // j
+    {0x00,0x40,0x40,0x40,0x40,0x44,0x48,0x50,0x70,0x48,0x44,0x42,0x00,0x00,0x00,0x00}, // k
+    {0x00,0x70,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x0E,0x00,0x00,0x00,0x00}, // l
+    {0x00,0x00,0x00,0x00,0x00,0x7F,0x49,0x49,0x49,0x49,0x49,0x49,0x00,0x00,0x00,0x00}, // m
+    {0x00,0x00,0x00,0x00,0x00,0x5C,0x62,0x42,0x42,0x42,0x42,0x42,0x00,0x00,0x00,0x00}, // n
+    {0x00,0x00,0x00,0x00,0x00,0x3C,0x66,0x42,0x42,0x42,0x66,0x3C,0x00,0x00,0x00,0x00}, // o
+    {0x00,0x00,0x00,0x00,0x00,0x7C,0x66,0x42,0x42,0x42,0x66,0x7C,0x40,0x40,0x40,0x00}, // p
+    {0x00,0x00,0x00,0x00,0x00,0x3E,0x66,0x42,0x42,0x42,0x66,0x3A,0x02,0x02,0x02,0x00}, // q
+    {0x00,0x00,0x00,0x00,0x00,0x3C,0x32,0x20,0x20,0x20,0x20,0x20,0x00,0x00,0x00,0x00}, // r
+    {0x00,0x00,0x00,0x00,0x00,0x3C,0x42,0x40,0x3C,0x02,0x42,0x3C,0x00,0x00,0x00,0x00}, // s
+    {0x00,0x00,0x00,0x10,0x10,0x7E,0x10,0x10,0x10,0x10,0x10,0x0E,0x00,0x00,0x00,0x00}, // t
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x42,0x42,0x42,0x42,0x46,0x3A,0x00,0x00,0x00,0x00}, // u
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x66,0x24,0x24,0x3C,0x18,0x18,0x00,0x00,0x00,0x00}, // v
+    {0x00,0x00,0x00,0x00,0x00,0x81,0x81,0x5A,0x5A,0x5A,0x24,0x24,0x00,0x00,0x00,0x00}, // w
+    {0x00,0x00,0x00,0x00,0x00,0x66,0x24,0x18,0x18,0x18,0x24,0x66,0x00,0x00,0x00,0x00}, // x
+    {0x00,0x00,0x00,0x00,0x00,0x42,0x22,0x24,0x24,0x14,0x18,0x08,0x08,0x10,0x30,0x00}, // y
+    {0x00,0x00,0x00,0x00,0x00,0x7E,0x02,0x04,0x18,0x20,0x40,0x7E,0x00,0x00,0x00,0x00}, // z
+    {0x00,0x1C,0x10,0x10,0x10,0x10,0x60,0x10,0x10,0x10,0x10,0x10,0x0C,0x00,0x00,0x00}, // {
+    {0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00}, // |
+    {0x00,0x70,0x10,0x10,0x10,0x10,0x0C,0x10,0x10,0x10,0x10,0x10,0x60,0x00,0x00,0x00}, // }
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x39,0x46,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, // ~
+};
+
+// Texto já montado em quads sobre o atlas. Só é remontado quando os valores que
+// o geram (key) mudam, então o sprintf e o layout não acontecem a cada quadro.
+struct TextLabel {
+    std::vector<float> vertices;    // x, y, u, v por vértice, quatro por caractere visível
+    int key[8];                     // Valores exibidos no texto atual
+    int keyCount;                   // 0 = ainda não montado
+};
+
+GLuint fontTexture;                 // Atlas com todos os glifos
+TextLabel statusLabel;              // Tempo, energia e estado
+TextLabel cullLabel;                // Contagens do recorte e dos níveis de detalhe
+TextLabel endLabel;                 // Mensagem de fim de jogo
+TextLabel pauseLabel;               // Aviso de pausa
+
+// --- Recorte por Frustum ---
+// Planos do volume de visão no espaço do mundo, tirados das matrizes de
+// gluPerspective e gluLookAt; um ponto está dentro quando a*x + b*y + c*z + d >= 0
+struct ViewFrustum {
+    float planes[6][4];
+    float eye[3];                   // Posição da câmera
+    float pixelScale;               // Pixels de raio projetado por unidade a uma unidade de distância
+};
+ViewFrustum viewFrustum;
+bool cullingEnabled = true;         // Falso com --no-culling
+bool lodEnabled = true;             // Falso com --no-lod
+const float PENGUIN_BOUND_RADIUS = 0.4f;   // Esfera que envolve o pinguim já na escala 0.8
+const float FISH_BOUND_RADIUS = 0.2f;      // Esfera que envolve corpo e cauda do peixe
+
+// --- Arena do Quadro ---
+// Memória de rascunho do desenho: tudo o que um quadro monta (fila de desenho, dados
+// de instância, animação dos peixes) sai de um bloco único que volta a ficar livre
+// em recordFrame. O que não couber vai para blocos avulsos do heap, e o próximo reset
+// cresce o bloco para que o quadro seguinte caiba inteiro.
+const size_t FRAME_ARENA_INITIAL_BYTES = 256 * 1024;
+
+struct FrameArena {
+    char* base;
+    size_t capacity;
+    size_t used;
+    size_t highWater;               // Maior uso de um quadro, contando os blocos avulsos
+    size_t overflowBytes;           // Bytes deste quadro que não couberam no bloco
+    std::vector<char*> overflow;    // Blocos avulsos, liberados no próximo reset
+    unsigned int epoch;             // Conta os resets; invalida os FrameArray antigos
+
+    void* allocate(size_t bytes, size_t align);
+    void reset();
+};
+
+FrameArena frameArena;
+
+// Vetor de rascunho cujos elementos moram na arena do quadro. Só serve para tipos
+// copiáveis byte a byte; ao virar o quadro o conteúdo some e o vetor volta vazio.
+template <typename T>
+struct FrameArray {
+    T* items;
+    int count;
+    int capacity;
+    unsigned int epoch;             // Reset da arena em que items foi obtido
+
+    void clear() {
+        count = 0;
+        if (epoch != frameArena.epoch) { items = NULL; capacity = 0; epoch = frameArena.epoch; }
+    }
+    void reserve(int n) {
+        if (epoch != frameArena.epoch) clear();
+        if (n <= capacity) return;
+        int grown = capacity ? capacity * 2 : 64;
+        if (grown < n) grown = n;
+        T* moved = (T*)frameArena.allocate(grown * sizeof(T), alignof(T));
+        if (count > 0) memcpy(moved, items, count * sizeof(T));
+        items = moved;
+        capacity = grown;
+    }
+    void resize(int n) { reserve(n); count = n; }
+    void push_back(const T& value) {
+        if (count == capacity || epoch != frameArena.epoch) reserve(count + 1);
+        items[count++] = value;
+    }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    T& operator[](int i) { return items[i]; }
+};
+
+// --- Desenho Instanciado ---
+bool useInstancing = true;          // Falso com --no-instancing
+bool instancingAvailable;           // O contexto suporta o caminho instanciado
+GLuint instanceProgram;             // Shader que aplica a transformação de cada instância
+GLint instanceKindLocation;
+GLuint instanceBuffer;              // Buffer com um vec4 por instância
+FrameArray<float> instanceData;     // Dados das instâncias montados a cada quadro
+FrameArray<float> lodInstanceData[NUM_LODS]; // Instâncias de peixe separadas por nível
+
+// --- Luzes e Névoa ---
+// Compartilhadas pelo pipeline fixo (init) e pelo bloco de uniforms do backend de shaders.
+// As posições são dadas com a modelview identidade, então valem no espaço do olho.
+const GLfloat SUN_POSITION[4] = {5.0f, 10.0f, 5.0f, 1.0f};
+const GLfloat SUN_AMBIENT[4] = {0.4f, 0.4f, 0.4f, 1.0f};
+const GLfloat SUN_DIFFUSE[4] = {1.0f, 1.0f, 0.9f, 1.0f};
+const GLfloat SUN_SPECULAR[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+const GLfloat FILL_POSITION[4] = {-5.0f, 8.0f, -5.0f, 1.0f};
+const GLfloat FILL_AMBIENT[4] = {0.0f, 0.0f, 0.0f, 1.0f};     // Padrão do OpenGL para GL_LIGHT1
+const GLfloat FILL_DIFFUSE[4] = {0.6f, 0.6f, 0.8f, 1.0f};
+const GLfloat FILL_SPECULAR[4] = {0.0f, 0.0f, 0.0f, 1.0f};    // Padrão do OpenGL para GL_LIGHT1
+const GLfloat SCENE_AMBIENT[4] = {0.2f, 0.2f, 0.2f, 1.0f};    // Padrão de GL_LIGHT_MODEL_AMBIENT
+const GLfloat FOG_COLOR[4] = {0.5f, 0.8f, 1.0f, 1.0f};
+const float FOG_START = 8.0f;
+const float FOG_END = 30.0f;
+
+// --- Céu ---
+const float SKYBOX_SIZE = 20.0f;    // Meia largura da caixa do céu
+const float SKYBOX_HEIGHT = 30.0f;
+const float SKYBOX_BOTTOM = -10.0f;
+const GLfloat SKY_SIDE_COLOR[3] = {0.6f, 0.9f, 1.0f};
+const GLfloat SKY_TOP_COLOR[3] = {0.4f, 0.7f, 1.0f};
+
+// --- Backend de Renderização ---
+// O pipeline fixo é o padrão; --renderer shader troca luzes, névoa, materiais e
+// display lists por shaders GLSL 3.30, vertex arrays e um uniform buffer por quadro
+enum RendererBackend { RENDERER_FIXED, RENDERER_SHADER };
+int rendererBackend = RENDERER_FIXED;
+
+// Dados por quadro do backend de shaders, no layout std140 do bloco FrameData
+struct FrameUniforms {
+    float projection[16];
+    float lightPosition[2][4];          // Espaço do olho
+    float lightAmbient[2][4];
+    float lightDiffuse[2][4];
+    float lightSpecular[2][4];
+    float sceneAmbient[4];
+    float fogColor[4];
+    float fogRange[4];                  // Início e fim da névoa linear
+};
+
+const GLuint FRAME_UNIFORM_BINDING = 0;
+const int INSTANCE_NONE = -1;       // Malha comum, só com a modelview
+const int INSTANCE_UNLIT = 2;       // Cor por vértice, sem iluminação (céu)
+const GLuint COLOR_ATTRIB = 2;      // Atributo de cor por vértice do céu
+GLuint sceneProgram;                // Programa único de todo o desenho 3D do backend de shaders
+GLint sceneModelViewLocation, sceneNormalMatrixLocation, sceneInstanceKindLocation;
+GLint sceneMaterialLocations[4];    // Ambiente, difusa, especular e brilho
+GLuint frameUniformBuffer;
+GLuint skyboxVertexArray, skyboxBuffer;
+int skyboxVertexCount;
+
+// --- Fila de Desenho e Cache de Estado ---
+// Material completo, como enviado por glMaterial
+struct Material {
+    float ambient[4];
+    float diffuse[4];
+    float specular[4];
+    float shininess;
+};
+
+// Desenho gravado na fila, com tudo que é preciso para reenviá-lo fora de ordem
+struct RenderCommand {
+    unsigned long long sortKey; // Camada e material no alto, ordem de envio embaixo
+    int material;
+    const Mesh* mesh;
+    float modelview[16];
+};
+
+// Último estado enviado ao OpenGL (-1 = desconhecido)
+struct GLStateCache {
+    int material;
+    int program;
+    int lighting;
+    int depthTest;
+    int depthMask;
+};
+
+std::vector<Material> materials;    // Materiais já usados, indexados pelo identificador
+const int MATERIAL_RESERVE = 32;    // Cores distintas do jogo, com folga: internar não realoca
+int currentMaterial;                // Material escolhido pelo último setMaterial
+FrameArray<RenderCommand> renderQueue;
+bool recordingQueue;                // Verdadeiro entre beginRenderQueue e flushRenderQueue
+GLStateCache stateCache;
+
+// --- Gerador Pseudoaleatório Determinístico ---
+// xoshiro128**: pequeno, rápido e com estado explícito, para que cada jogo seja
+// reproduzível a partir da sua semente
+struct GameRng {
+    unsigned int s[4];
+};
+
+// --- Gravação e Replay de Entrada ---
+// Evento de entrada aplicado no início de um passo da simulação
+enum InputEventType {
+    INPUT_ACTION = 0,   // Ação de controle do pinguim mãe
+    INPUT_RESET = 1,    // Reinício do jogo com uma nova semente
+    INPUT_END = 2,      // Fim da sessão gravada
+    INPUT_KEYS = 3      // Nova máscara de teclas de controle seguradas (em action)
+};
+struct InputEvent {
+    long long step;             // Passo da sessão em que o evento é aplicado
+    unsigned char type;
+    unsigned char action;
+    unsigned long long seed;
+    double timestamp;           // Instante em que a entrada ao vivo foi lida (não vai para o log)
+};
+
+long long sessionStep;              // Passos simulados desde o início da sessão
+std::mutex inputMutex;              // Protege pendingInputs e latencyWaiting entre a GLUT e a simulação
+std::vector<InputEvent> pendingInputs;  // Entradas ao vivo esperando o próximo passo
+std::condition_variable inputArrived;   // Acorda a simulação parada quando chega entrada (com inputMutex)
+std::vector<InputEvent> recordedInputs; // Entradas aplicadas, gravadas com --record
+std::vector<InputEvent> replayInputs;   // Entradas lidas de --replay
+int replayCursor;
+unsigned long long recordSeed;      // Semente inicial da sessão gravada
+const char* recordPath = NULL;
+const char* replayPath = NULL;
+int heldKeys;                       // Teclas de controle seguradas agora, atualizadas pela GLUT
+int sessionKeys;                    // Máscara em vigor na simulação, mudada só por INPUT_KEYS
+bool legacyInputLog = false;        // Replay de log versão 1: só eventos INPUT_ACTION, sem teclas seguradas
+bool legacySpawner = false;         // Replay de log anterior à versão 3: sorteio sem distância mínima
+
+// --- Latência de Entrada ---
+// Tempo entre a leitura de uma tecla e a troca de buffers do primeiro quadro
+// desenhado depois do passo que a aplicou
+const int LATENCY_HISTORY = 1024;
+std::vector<InputEvent> latencyWaiting; // Entradas já aplicadas (passo e instante), à espera da troca
+double inputLatencyMs[LATENCY_HISTORY];
+long long latencyCount;
+TextLabel latencyLabel;
+
+// --- Renderização Fora da Tela e Captura ---
+// Quadro lido do framebuffer, esperando a thread de gravação
+struct CapturedFrame {
+    int index;
+    int width, height;
+    std::vector<unsigned char> pixels;          // RGBA, origem no canto inferior esquerdo
+    mutable std::vector<unsigned char> encodeBuffer; // Reaproveitado pelo codificador PNG
+};
+
+// Fila limitada entre o laço de desenho e a thread de gravação. Os buffers
+// circulam entre freeFrames e pending, então não há alocação por quadro.
+struct CaptureQueue {
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+    std::deque<CapturedFrame*> pending;
+    std::vector<CapturedFrame*> freeFrames;
+    bool done;
+    int framesWritten;
+    double stallSeconds;        // Tempo que o desenho esperou por um buffer livre
+};
+
+const int CAPTURE_QUEUE_CAPACITY = 8;
+CaptureQueue captureQueue;
+std::thread captureThread;
+GLuint capturePixelBuffers[2];      // Pixel buffers alternados para a leitura assíncrona
+const char* capturePrefix = NULL;   // Prefixo dos arquivos capturados (--capture)
+bool capturePng = false;            // PNG em vez de PPM (--capture-format png)
+
+// --- Candidatos da Broadphase ---
+// Coordenadas dos candidatos devolvidos pela grade, copiadas para colunas contíguas
+// para que o teste exato rode em lote com os kernels SIMD
+struct CandidateBatch {
+    std::vector<float> x, y, z, radius;
+    std::vector<int> dense;          // Índice denso de cada candidato no pool
+    std::vector<unsigned char> hit;  // Máscara de colisão devolvida pelo kernel
+    int count;
+};
+
+// --- Geração de Peixes e Buracos (amostragem de disco de Poisson) ---
+// Cada novo peixe ou buraco respeita uma distância mínima até todas as entidades já
+// presentes e fica fora das zonas de exclusão. Os candidatos são testados contra as
+// grades espaciais da partida, então cada teste só visita as células vizinhas, e o
+// número de candidatos por geração é fixo: numa plataforma saturada a geração falha
+// com custo limitado e o timer tenta de novo no próximo intervalo.
+enum SpawnKind { SPAWN_FISH, SPAWN_HOLE, SPAWN_PENGUIN, SPAWN_NUM_KINDS };
+
+// Distância mínima entre centros (linha: tipo gerado; coluna: tipo já presente)
+const float SPAWN_MIN_DISTANCE[2][SPAWN_NUM_KINDS] = {
+    {0.6f, 0.8f, 0.8f},     // Peixe: fora dos buracos e fora do alcance imediato dos pinguins
+    {0.8f, 1.0f, 1.2f}      // Buraco: nunca embaixo de um pinguim nem sobre outro buraco
+};
+const int SPAWN_ATTEMPTS = 30;          // Candidatos por geração, no máximo
+const int SPAWN_UNIFORM_ATTEMPTS = 20;  // Os primeiros são uniformes; os outros, no anel de um vizinho
+const float SPAWN_AREA_FRACTION = 0.8f; // Fração do lado da plataforma onde há geração
+const float SPAWN_CENTER_EXCLUSION = 2.0f; // Buracos longe do bebê, no centro
+
+// Disco onde certos tipos não podem nascer
+struct SpawnExclusion {
+    float x, z, radius;
+    int kinds;                  // Bits (1 << SpawnKind) dos tipos barrados
+};
+
+// --- Agenda de Eventos (roda de temporização hierárquica) ---
+// Eventos marcados para um passo da simulação. Cada nível tem 64 casas e o nível l anda
+// de 64^l em 64^l passos; quando o bloco de passos de uma casa chega, os eventos dela
+// descem para um nível mais fino. Marcar, cancelar e disparar custam O(1) por evento,
+// não importa quantos estejam pendentes.
+const int TIMER_WHEEL_BITS = 6;
+const int TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+const int TIMER_WHEEL_LEVELS = 4;   // Horizonte de 64^4 passos; além disso o evento espera no topo
+
+// Tipos de evento, na ordem em que os disparados num mesmo passo são tratados
+enum TimerKind {
+    TIMER_GAME_END = 0,             // Fim do tempo de jogo: vitória
+    TIMER_ENERGY_DEADLINE,          // Energia do bebê esgotada: derrota (vence a vitória do mesmo passo)
+    TIMER_HOLE_EXPIRY,              // Buraco que se fecha (GameParams::holeLifetime)
+    TIMER_FISH_SPAWN,               // Pedido de um peixe para a fase de geração do passo
+    TIMER_HOLE_SPAWN,
+    TIMER_BENCH                     // Só do benchmark da agenda
+};
+
+// Referência a um evento marcado; deixa de valer quando ele dispara ou é cancelado
+struct TimerHandle {
+    int event;                      // Índice na roda (-1 = nenhum)
+    unsigned int generation;
+};
+const TimerHandle NO_TIMER = {-1, 0};
+
+struct TimerEvent {
+    long long due;                  // Passo em que dispara
+    int kind;
+    int target;                     // Slot da entidade alvo, se houver
+    int prev, next;                 // Vizinhos na lista da casa (-1 = ponta)
+    int bucket;                     // Casa em que está (-1 = livre)
+    unsigned int generation;        // Muda a cada reuso, invalidando handles antigos
+};
+
+struct FiredTimer {
+    int kind;
+    int target;
+};
+
+struct TimerWheel {
+    std::vector<TimerEvent> events;
+    std::vector<int> freeEvents;
+    int buckets[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS]; // Primeiro evento de cada casa
+    long long now;                  // Último passo já processado
+    int pending;                    // Eventos marcados e ainda não disparados
+    std::vector<FiredTimer> fired;  // Disparados pelo último advance, ordenados por tipo
+
+    void reset(long long start, int capacity);
+    TimerHandle schedule(long long due, int kind, int target);
+    bool cancel(TimerHandle& handle);
+    void advance(long long step);
+    void link(int e);
+    void unlink(int e);
+};
+
+// --- Mundo do Jogo ---
+// Todo o estado de uma partida. O núcleo da simulação só enxerga o mundo que
+// recebe, então vários mundos podem ser simulados ao mesmo tempo, um por thread.
+struct GameWorld {
+    GameParams params;
+    int gameState;                  // 0: Jogando, 1: Vitória, 2: Derrota
+    float gameTime;                 // Tempo de jogo decorrido
+    float babyEnergyTime;           // Tempo restante para a energia do bebê
+    long long step;                 // Passos simulados desde o início da partida
+    TimerWheel timers;              // Fim de jogo, prazo da energia, gerações e buracos que se fecham
+    TimerHandle energyDeadline;     // Derrota marcada para quando a energia acabar
+    std::vector<TimerHandle> holeExpiry; // Fechamento marcado de cada slot de buraco
+    int fishSpawnSteps;             // Intervalos em passos, contados como a soma em float contaria
+    int holeSpawnSteps;
+    int energySteps;
+    int holeLifetimeSteps;          // 0 = buracos não se fecham
+    int fishSpawnDue;               // Gerações pedidas pela agenda neste passo
+    int holeSpawnDue;
+    int fishDelivered;              // Peixes entregues ao bebê nesta partida
+    unsigned long long seed;        // Semente da partida
+    GameRng rng;
+    Penguin motherPenguin;
+    Penguin babyPenguin;
+    FishPool fishes;
+    HolePool holes;
+    SpatialGrid fishGrid;           // Peixes, indexados pelo slot do pool
+    SpatialGrid holeGrid;           // Buracos, indexados pelo slot do pool
+    SpatialGrid penguinGrid;        // Pinguins mãe e bebê
+    std::vector<Position> extraPenguins; // Outros pinguins que barram a geração (pares da arena)
+    SpatialGrid extraPenguinGrid;   // Os mesmos, indexados pela posição em extraPenguins
+    std::vector<SpawnExclusion> spawnExclusions;
+    std::vector<int> queryResults;  // Resultado reaproveitado das consultas à grade
+    CandidateBatch candidates;
+};
+
 // --- Objetos Globais do Jogo ---
-Penguin motherPenguin;
-Penguin babyPenguin;
-std::vector<Fish> fishes;
-std::vector<Hole> holes;
+GameWorld world;                    // Partida mostrada na janela (ou reproduzida pelo replay)
+FrameArray<float> fishBobOffsets;   // Saída do kernel de animação dos peixes
+FrameArray<float> fishYaws;
+
+// --- Ambiente Vetorizado para Treino ---
+// N partidas independentes avançadas juntas por uma chamada. A ação de cada partida é a
+// máscara de ControlKey do passo; a observação é um vetor fixo de OBS_SIZE floats, escrito
+// direto no buffer de quem chama. Partidas terminadas recomeçam sozinhas na chamada em
+// que terminam (a observação já é a da partida nova).
+const int ENV_NEAR_MAX = 8;         // Limite de ENV_NEAR_FISH e ENV_NEAR_HOLES
+const int ENV_NEAR_FISH = 4;        // Peixes mais próximos da mãe na observação
+const int ENV_NEAR_HOLES = 4;       // Buracos mais próximos da mãe na observação
+const int ENV_CHUNK = 32;           // Partidas por tarefa do parallelFor
+const float ENV_REWARD_DELIVERY = 1.0f; // Por peixe entregue ao bebê
+const float ENV_REWARD_WIN = 5.0f;      // Somadas no passo em que a partida termina
+const float ENV_REWARD_LOSS = -5.0f;
+enum EnvObservation {
+    OBS_MOTHER_X, OBS_MOTHER_Z,     // Posição da mãe na plataforma
+    OBS_FORWARD_X, OBS_FORWARD_Z,   // Direção em que CONTROL_FORWARD anda
+    OBS_HAS_FISH,                   // 1 se a mãe carrega um peixe
+    OBS_BABY_DX, OBS_BABY_DZ,       // Bebê em relação à mãe
+    OBS_ENERGY,                     // Energia restante do bebê, em fração do máximo
+    OBS_TIME,                       // Tempo de jogo decorrido, em fração da duração
+    OBS_FISH,                       // ENV_NEAR_FISH x (dx, dz, 1), do mais próximo ao mais distante
+    OBS_HOLES = OBS_FISH + 3 * ENV_NEAR_FISH, // ENV_NEAR_HOLES x (dx, dz, raio); vagas sobrando zeradas
+    OBS_SIZE = OBS_HOLES + 3 * ENV_NEAR_HOLES
+};
+
+struct VecEnv {
+    int numEnvs;
+    GameParams params;                          // Valem a partir do próximo resetVecEnv
+    std::vector<GameWorld> worlds;
+    std::vector<unsigned long long> nextSeeds;  // Semente do próximo recomeço de cada partida
+    std::vector<int> delivered;                 // Entregas já recompensadas na partida atual
+    unsigned long long seed;                    // Da chamada de reset em andamento
+    const int* actions;                         // Buffers da chamada em andamento
+    float* observations;
+    float* rewards;
+    unsigned char* dones;
+};
+
+// Ambientes vivos criados pela API C. Todos dividem o sistema de tarefas do processo: o
+// primeiro o inicia (se ninguém o fez) e o último a ser destruído o para.
+std::mutex envApiMutex;
+int envApiCount = 0;
+bool envApiStartedJobs = false;     // O sistema de tarefas foi iniciado pela API C
+
+// --- Piloto Automático ---
+// Grade de ocupação da plataforma: cada célula conta quantos buracos, inflados pelo raio
+// do pinguim, cobrem o seu centro. Carimbar e apagar um buraco só toca as células do seu
+// disco, então a grade acompanha os buracos sem ser refeita do zero.
+struct OccupancyGrid {
+    float cellSize;
+    float originX, originZ;             // Canto (-x, -z) da grade
+    int cellsX, cellsZ;
+    std::vector<unsigned short> cover;  // Buracos inflados que cobrem cada célula
+    int version;                        // Muda a cada carimbo; caminhos de versões antigas são refeitos
+
+    // reset: Cria uma grade vazia para uma plataforma quadrada de lado size.
+    void reset(float size, float cell) {
+        cellSize = cell;
+        originX = originZ = -size / 2.0f;
+        cellsX = cellsZ = std::max(1, (int)ceil(size / cell));
+        cover.assign(cellsX * cellsZ, 0);
+        version = 0;
+    }
+
+    // cellOf: Célula que contém o ponto (x, z), presa às bordas da grade.
+    int cellOf(float x, float z) const {
+        int cx = std::min(std::max((int)((x - originX) / cellSize), 0), cellsX - 1);
+        int cz = std::min(std::max((int)((z - originZ) / cellSize), 0), cellsZ - 1);
+        return cz * cellsX + cx;
+    }
+    float centerX(int cell) const { return originX + (cell % cellsX + 0.5f) * cellSize; }
+    float centerZ(int cell) const { return originZ + (cell / cellsX + 0.5f) * cellSize; }
+    bool blocked(int cell) const { return cover[cell] != 0; }
+
+    // stamp: Soma delta (+1 carimba, -1 apaga) nas células cujo centro está no disco.
+    void stamp(float x, float z, float radius, int delta) {
+        int x0 = std::max((int)((x - radius - originX) / cellSize), 0);
+        int x1 = std::min((int)((x + radius - originX) / cellSize), cellsX - 1);
+        int z0 = std::max((int)((z - radius - originZ) / cellSize), 0);
+        int z1 = std::min((int)((z + radius - originZ) / cellSize), cellsZ - 1);
+        for (int cz = z0; cz <= z1; ++cz) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                float dx = originX + (cx + 0.5f) * cellSize - x;
+                float dz = originZ + (cz + 0.5f) * cellSize - z;
+                if (dx * dx + dz * dz <= radius * radius) cover[cz * cellsX + cx] += delta;
+            }
+        }
+        version++;
+    }
+};
+
+// Nó da fila de prioridade do A*
+struct PathNode {
+    float f;                            // Custo até aqui mais a estimativa até o objetivo
+    int cell;
+    bool operator<(const PathNode& o) const { return f > o.f; } // Heap de mínimo
+};
+
+// Buffers de busca reaproveitados entre planejamentos. As marcas de busca evitam
+// limpar os vetores a cada chamada; cada thread usa o seu.
+struct PathPlanner {
+    std::vector<float> cost;            // Custo do melhor caminho conhecido até a célula
+    std::vector<int> parent;
+    std::vector<unsigned int> opened;   // Busca em que a célula recebeu um custo
+    std::vector<unsigned int> closed;   // Busca em que a célula foi expandida
+    std::vector<PathNode> open;
+    unsigned int search;
+    int expanded;                       // Células expandidas no último planejamento
+};
+
+// Estado do piloto de um mundo: grade, caminho atual e o que o tornaria obsoleto
+struct AutopilotAgent {
+    OccupancyGrid grid;
+    PathPlanner planner;
+    std::vector<float> stampX, stampZ, stampRadius; // Buraco carimbado em cada slot (raio 0 = nenhum)
+    std::vector<int> path;              // Células do caminho, do passo seguinte ao objetivo
+    int cursor;                         // Próxima célula do caminho a alcançar
+    int aim;                            // Célula do caminho mirada (-1: escolher de novo)
+    int goalCell;
+    int pathVersion;                    // Versão da grade usada no caminho atual
+    std::vector<int> unreachable;       // Objetivos sem caminho nesta versão da grade
+    long long plans;                    // Planejamentos feitos
+};
+
+const float AUTOPILOT_CELL_SIZE = 0.25f;
+const float AUTOPILOT_CLEARANCE = 0.3f;   // Raio do pinguim; a diferença de altura até o buraco já dá folga
+const float AUTOPILOT_PICKUP_REACH = 0.5f; // Distância no plano em que o peixe certamente é pego
+const float AUTOPILOT_ESCAPE_COST = 20.0f; // Custo extra de cada célula bloqueada ao sair de uma
+const int AUTOPILOT_LOOKAHEAD = 8;        // Células à frente testadas na suavização do caminho
+const float AUTOPILOT_AIM_DEGREES = 20.0f; // Só anda para frente com o erro de direção abaixo disto
+std::atomic<bool> autopilotEnabled(false); // --autopilot ou tecla 'a'
+AutopilotAgent autopilot;                 // Piloto da partida da janela
+
+// Contadores de um trabalhador no benchmark do planejador, numa linha de cache própria
+struct alignas(64) PlannerStats {
+    long long plans, found;
+    long long expanded;                   // Células expandidas somadas
+    long long length;                     // Células dos caminhos encontrados somadas
+    unsigned long long checksum;
+};
+
+// Estado de uma execução de runPlannerBenchmark
+struct PlannerBenchmark {
+    OccupancyGrid grid;                   // Só lida durante os planejamentos
+    std::vector<int> starts, goals;
+    int plansPerJob;
+    std::vector<PathPlanner> planners;    // Um por trabalhador
+    std::vector<std::vector<int> > paths;
+    std::vector<PlannerStats> stats;
+};
+
+// --- Benchmarks (--bench) ---
+typedef void (*BenchFunction)(void* context, int iterations);
+
+// Estatística de um caso, em nanossegundos por operação
+struct BenchResult {
+    std::string name;
+    int param;                            // Tamanho do caso (entidades, elementos)
+    int samples;
+    int iterations;                       // Operações por amostra, calibradas
+    double medianNs, p99Ns, minNs;
+};
+
+// Esferas sorteadas para o benchmark de checkCollision
+struct CollisionBench {
+    std::vector<Position> a, b;
+    int hits;
+};
+
+// Agenda com um número fixo de eventos pendentes, para o benchmark da roda
+struct TimerBench {
+    TimerWheel wheel;
+    std::vector<TimerHandle> handles;   // Um por evento, indexado pelo alvo
+    GameRng rng;
+    long long step;
+    int horizon;                        // Atrasos sorteados em [1, horizon]
+};
+
+// Lote de partidas e buffers do benchmark do ambiente vetorizado
+struct EnvBench {
+    VecEnv env;
+    std::vector<int> actions;           // Sorteadas uma vez, como teclas seguradas
+    std::vector<float> observations;
+    std::vector<float> rewards;
+    std::vector<unsigned char> dones;
+};
+
+const unsigned long long BENCH_SEED = 12345;  // Semente fixa dos casos, independente de --seed
+const double BENCH_SAMPLE_SECONDS = 0.005;    // Duração alvo de cada amostra
+const int SATURATED_SPAWN_HOLES = 4096;       // Buracos pedidos no caso de plataforma saturada
+int benchSamples = 31;                        // --bench-samples
+float benchRegressionThreshold = 1.10f;       // --bench-threshold: mediana atual / anterior acima disto é regressão
+const char* benchFilter = NULL;               // --bench-filter: só casos com este trecho no nome
+const char* benchOutputPath = NULL;           // --bench-out: CSV dos resultados
+const char* benchBaselinePath = NULL;         // --bench-baseline: CSV de um commit anterior
+std::vector<BenchResult> benchResults;
+
+// --- Sistema de Tarefas ---
+typedef void (*JobFunction)(void* context, int job, int worker);
+
+// Fila de tarefas de um trabalhador, numa linha de cache própria
+struct alignas(64) JobQueue {
+    std::mutex mutex;
+    std::deque<int> jobs;
+};
+
+// Threads trabalhadoras persistentes que atendem um parallelFor por vez
+struct JobSystem {
+    std::vector<std::thread> threads;
+    JobQueue* queues;                   // Uma fila por trabalhador (0 = thread que chama)
+    int numWorkers;
+    std::mutex mutex;
+    std::condition_variable wake;       // Novo parallelFor ou pedido de saída
+    std::condition_variable finished;   // Última tarefa concluída
+    unsigned long long generation;      // Incrementado a cada parallelFor
+    std::atomic<int> remaining;         // Tarefas ainda não concluídas
+    JobFunction function;
+    void* context;
+    bool quit;
+};
+JobSystem jobSystem;
+
+// --- Execução em Lote ---
+// Parâmetro que pode ser variado com --sweep nome=v1,v2,...
+struct SweepParam {
+    const char* name;
+    size_t offset;                      // Posição do campo em GameParams
+    bool isInt;
+};
+const SweepParam SWEEP_PARAMS[] = {
+    {"duration", offsetof(GameParams, gameDuration), false},
+    {"energy", offsetof(GameParams, babyEnergyMax), false},
+    {"speed", offsetof(GameParams, penguinSpeed), false},
+    {"rotation-speed", offsetof(GameParams, rotationSpeed), false},
+    {"platform", offsetof(GameParams, icePlatformSize), false},
+    {"max-fish", offsetof(GameParams, maxFish), true},
+    {"max-holes", offsetof(GameParams, maxHoles), true},
+    {"fish-interval", offsetof(GameParams, fishSpawnInterval), false},
+    {"hole-interval", offsetof(GameParams, holeSpawnInterval), false},
+    {"hole-lifetime", offsetof(GameParams, holeLifetime), false},
+};
+const int NUM_SWEEP_PARAMS = sizeof(SWEEP_PARAMS) / sizeof(SWEEP_PARAMS[0]);
+
+struct SweepAxis {
+    const SweepParam* param;
+    std::vector<double> values;
+};
+
+// Resultados somados de uma configuração; cada trabalhador tem os seus, em linhas de cache separadas
+struct alignas(64) BatchStats {
+    int games, wins, losses;
+    long long fishDelivered;
+    long long steps;
+    double survivalTime;                // Soma do tempo de jogo ao fim de cada partida
+    long long plans;                    // Planejamentos do piloto automático
+    unsigned long long checksum;
+};
+
+struct BatchConfig {
+    GameParams params;
+    BatchStats stats;
+};
+
+// Estado de uma execução de runHeadless, compartilhado (só para leitura) pelas tarefas
+struct BatchRun {
+    unsigned long long baseSeed;
+    int gamesPerConfig;
+    int gamesPerJob;
+    int jobsPerConfig;
+    std::vector<GameWorld> worlds;      // Um mundo por trabalhador, reaproveitado entre jogos
+    std::vector<AutopilotAgent> pilots; // Piloto de cada mundo, usado com --autopilot
+    std::vector<BatchStats> stats;      // [trabalhador * configurações + configuração]
+};
+
+std::vector<SweepAxis> sweepAxes;
+std::vector<BatchConfig> batchConfigs;
+
+// --- Arena com Muitos Pinguins ---
+// Pares mãe/bebê guardados em colunas, um índice por par, sobre uma única plataforma.
+// Os bebês ficam parados; um par sai do jogo quando o bebê fica sem energia ou a mãe
+// cai num buraco, pelas mesmas regras da partida.
+struct ArenaPairs {
+    std::vector<float> motherX, motherZ, rotation, wingAnimation;
+    std::vector<unsigned char> isMoving;
+    std::vector<float> babyX, babyZ;
+    std::vector<float> energy;              // Tempo restante para a energia do bebê
+    std::vector<long long> energyDeadline;  // Passo em que a energia acaba (-1 = nunca)
+    std::vector<unsigned char> hasFish;
+    std::vector<unsigned char> alive;
+    std::vector<int> fishDelivered;
+    int count;
+};
+
+// Pedido de um par para pegar um peixe, resolvido depois da fase paralela
+struct ArenaClaim {
+    int pair;
+    int fishSlot;
+};
+
+struct ArenaWorld {
+    GameWorld field;                        // Plataforma: peixes, buracos, agenda e geração da partida
+    ArenaPairs pairs;
+    std::vector<std::vector<ArenaClaim> > chunkClaims;      // Pedidos de cada pedaço
+    std::vector<std::vector<int> > workerQueries;           // Resultado das consultas de cada trabalhador
+    std::vector<CandidateBatch> workerCandidates;           // Candidatos da broadphase de cada trabalhador
+    int aliveCount;
+    long long claimConflicts;               // Pedidos perdidos para um par de índice menor
+};
+
+const int ARENA_CHUNK_SIZE = 256;           // Pares por tarefa da fase paralela
+const float ARENA_CELL_SIZE = 4.0f;         // Células maiores: a arena tem centenas de unidades
+const float ARENA_SIGHT_RADIUS = 6.0f;      // Distância em que uma mãe enxerga um peixe
+const float ARENA_AREA_PER_PAIR = 36.0f;    // Área da plataforma por par (lado de 6 unidades)
+ArenaWorld arena;
+bool arenaView;                     // Desenha a arena em vez da partida (--arena com --offscreen)
+
+// --- Loop de Passo Fixo ---
+const int MAX_STEPS_PER_FRAME = 5;  // Limite de passos de recuperação por quadro
+const double MAX_FRAME_TIME = 0.25; // Maior intervalo real aceito por quadro (em segundos)
+double lastFrameClock;              // Instante (relógio monotônico) do último quadro
+double simAccumulator;              // Tempo real ainda não consumido pela simulação
+float renderAlpha = 1.0f;           // Fração entre o passo anterior e o atual para interpolação
+Penguin prevMotherPenguin;          // Estado do passo anterior, usado na interpolação
+Penguin prevBabyPenguin;
+Penguin renderMotherPenguin;        // Estado interpolado que é efetivamente desenhado
+Penguin renderBabyPenguin;
+
+// --- Ritmo dos Quadros ---
+// O timer da GLUT é remarcado para prazos absolutos (prazo += período), então o erro
+// de cada espera não se acumula de um quadro para o outro. Com a cena parada (pausa
+// ou fim de partida) e o último retrato já na tela, nenhum quadro é pedido: o timer
+// só confere o estado a cada IDLE_POLL_MS, e a simulação dorme até chegar entrada.
+const int IDLE_POLL_MS = 100;       // Período do timer com a cena parada
+const double IDLE_SIM_WAIT = 0.25;  // Espera máxima da simulação parada antes de reconferir
+int frameCap = 60;                  // Quadros por segundo (--fps-cap; 0 = só o vsync limita)
+bool vsyncRequested = true;         // --vsync off: a troca de buffers não espera o retraço
+int swapInterval = -1;              // Intervalo de troca aplicado (-1 = o driver não deixa escolher)
+const char* swapControl = "nenhum"; // Extensão usada para o intervalo de troca
+double nextFrameDeadline;           // Instante em que o próximo quadro deve ser pedido
+int pacerGeneration;                // Timers de uma geração antiga são ignorados ao disparar
+bool pacerIdle;                     // O timer está no ritmo de espera
+bool redrawRequested = true;        // Algo fora da simulação mudou (teclas, janela, HUD)
+bool windowHidden;                  // A janela não está visível: não há o que desenhar
+long long lastDrawnStep = -1;       // Passo do último retrato desenhado
+double lastSwapClock;               // Fim da última troca (0 = depois de uma espera, sem intervalo)
+long long idlePolls;                // Conferências do timer em que o quadro foi dispensado
+std::atomic<bool> simPaused(false); // Barra de espaço: a simulação não avança
+
+// --- Retratos do Mundo (simulação -> desenho) ---
+// Cópia imutável do que o desenho precisa de um passo. A simulação escreve num
+// retrato próprio e o publica trocando-o atomicamente pelo do meio de um buffer
+// triplo; o desenho pega o mais novo da mesma forma. Nenhum lado espera o outro,
+// e cada um só toca o retrato que possui.
+struct WorldSnapshot {
+    long long step;                 // Passos simulados até este retrato (0 = vazio)
+    unsigned long long seed;
+    int gameState;
+    float gameTime;
+    float babyEnergyTime;
+    float icePlatformSize;
+    Penguin prevMotherPenguin, prevBabyPenguin; // Passo anterior, para a interpolação
+    Penguin motherPenguin, babyPenguin;
+    FishPool fishes;                // Só as colunas e o count
+    HolePool holes;
+    double simClock;                // Instante do relógio em que este passo vencia
+    double simMsTotal;              // Tempo gasto pela simulação até aqui
+    unsigned long long checksum;    // Hash do conteúdo, preenchido pelo teste de estresse
+};
+
+const int SNAPSHOT_FRESH = 4;       // Bit do índice do meio: publicado e ainda não lido
+struct SnapshotBuffer {
+    WorldSnapshot slots[3];
+    std::atomic<int> middle;        // Retrato trocado entre os dois lados (mais SNAPSHOT_FRESH)
+    int back;                       // Só do escritor
+    int front;                      // Só do leitor
+
+    // reset: Volta ao estado inicial, com os três retratos vazios.
+    void reset() {
+        for (int i = 0; i < 3; ++i) slots[i].step = 0;
+        back = 0;
+        middle.store(1);
+        front = 2;
+    }
+};
+
+SnapshotBuffer worldSnapshots;      // Partida da janela
+const WorldSnapshot* renderView;    // Retrato usado pelo quadro sendo desenhado
+bool useSimThread = true;           // Falso com --no-sim-thread: simulação dentro do timer da GLUT
+bool simThreadRunning;
+std::thread simThread;
+std::atomic<bool> simThreadStop(false);
+double simMsTotal;                  // Tempo de simulação acumulado (da thread que simula)
+long long lastShownStep;            // Passo e tempo de simulação do último retrato desenhado
+double lastShownSimMs;
+const int STRESS_ENTITIES = 512;    // Peixes e buracos por retrato no teste de estresse
+
+// --- Telemetria de Tempo de Quadro ---
+// Registro por quadro do tempo gasto na simulação, no desenho e na troca de buffers
+struct FrameTiming {
+    double simMs;
+    double renderMs;
+    double swapMs;
+    int steps;
+    int drawCalls;
+    int stateIssued;    // Chamadas de estado enviadas pela fila/cache
+    int stateSkipped;   // Chamadas de estado descartadas por serem redundantes
+    int entitiesDrawn;  // Pinguins, peixes e buracos que passaram pelo recorte
+    int entitiesCulled; // Descartados por estarem fora do volume de visão
+    int lodCounts[NUM_LODS];
+    int textLayouts;    // Textos do HUD remontados neste quadro
+    int allocations;    // Chamadas de operator new no processo durante o quadro
+    double intervalMs;  // Entre esta troca e a anterior (0 = primeiro quadro depois de uma espera)
+};
+const int FRAME_HISTORY = 1024;     // Quantidade de quadros mantidos no histórico circular
+FrameTiming frameTimings[FRAME_HISTORY];
+FrameTiming currentFrame;           // Quadro sendo medido
+long long frameCount;               // Total de quadros registrados
+long long droppedSteps;             // Passos descartados pelo limite de recuperação
+const char* frameLogPath = NULL;    // Arquivo CSV para o histórico de quadros (--frame-log)
+
+// --- Contagem de Alocações ---
+// Um operator new global conta toda alocação feita pelo C++, inclusive a de bibliotecas
+// como o compilador de shaders do driver; malloc direto não entra. Desligado por padrão,
+// já que põe um incremento atômico em cada new do jogo; -DPENGUIN_ALLOC_COUNTER=1 liga
+// (para --check-allocs). Nunca na biblioteca do ambiente, onde trocaria o operator new
+// do processo que a carrega.
+#ifndef PENGUIN_ALLOC_COUNTER
+#define PENGUIN_ALLOC_COUNTER 0
+#endif
+#if PENGUIN_ALLOC_COUNTER && defined(PENGUIN_ENV_LIBRARY)
+#error "PENGUIN_ALLOC_COUNTER nao pode ser ligado na biblioteca do ambiente"
+#endif
+std::atomic<long long> heapAllocations(0);
+long long frameStartAllocations;    // heapAllocations no início do quadro atual
+
+// --- Profiler de Quadro ---
+// Zonas medidas pelo profiler (o índice também escolhe a cor no gráfico do HUD)
+enum ProfileZone {
+    PROFILE_SIM_STEP = 0,
+    PROFILE_COLLISION,
+    PROFILE_SPAWN,
+    PROFILE_DRAW_SCENE,
+    PROFILE_DRAW_SKYBOX,
+    PROFILE_DRAW_PLATFORM,
+    PROFILE_DRAW_PENGUIN,
+    PROFILE_DRAW_FISH,
+    PROFILE_DRAW_HOLE,
+    PROFILE_FLUSH_QUEUE,
+    PROFILE_DRAW_UI,
+    PROFILE_SWAP,
+    PROFILE_ARENA_UPDATE,
+    PROFILE_ARENA_RESOLVE,
+    PROFILE_TIMERS,
+    PROFILE_NUM_ZONES
+};
+const char* PROFILE_ZONE_NAMES[PROFILE_NUM_ZONES] = {
+    "simulateStep", "collision", "spawn", "drawScene", "drawSkybox", "drawIcePlatform",
+    "drawPenguin", "drawFish", "drawHole", "flushRenderQueue", "drawUI", "glutSwapBuffers",
+    "arenaChunk", "arenaResolve", "timers"
+};
+
+// Uma medição: zona, início e duração em nanossegundos
+struct ProfileSample {
+    std::atomic<unsigned long long> sequence; // Índice de escrita + 1 quando o slot está completo
+    long long startNs;
+    long long durationNs;
+    unsigned short zone;
+    unsigned short thread;
+};
+
+const int PROFILE_RING_SIZE = 1 << 16;  // Capacidade do anel (potência de 2)
+const int PROFILE_HUD_FRAMES = 120;     // Quadros mostrados no gráfico do HUD
+ProfileSample profileRing[PROFILE_RING_SIZE];
+std::atomic<unsigned long long> profileWriteIndex(0);
+std::atomic<bool> profilerEnabled(false);   // Ligado com --profile ou pela tecla 'p'
+std::atomic<int> profileThreadCount(0);
+std::atomic<long long> profileZoneFrameNs[PROFILE_NUM_ZONES];  // Soma do quadro atual, de todas as threads
+double profileZoneHistory[PROFILE_HUD_FRAMES][PROFILE_NUM_ZONES];
+int profileHistoryFrame;
+const char* profileOutputPath = NULL;   // Arquivo .json (Chrome trace) ou .csv (--profile-out)
+
+long long profileNowNs();
+void profileRecord(int zone, long long startNs, long long durationNs);
+int profileThreadIndex();
+
+// ProfileScope: Mede o tempo de vida do escopo. Com o profiler desligado o custo é
+// uma leitura atômica e um desvio.
+struct ProfileScope {
+    int zone;
+    long long startNs;
+    ProfileScope(int z) : zone(z), startNs(0) {
+        if (profilerEnabled.load(std::memory_order_relaxed)) startNs = profileNowNs();
+    }
+    ~ProfileScope() {
+        if (startNs != 0) profileRecord(zone, startNs, profileNowNs() - startNs);
+    }
+};
+
+#ifndef PENGUIN_PROFILER
+#define PENGUIN_PROFILER 1
+#endif
+#if PENGUIN_PROFILER
+#define PROFILE_SCOPE(zone) ProfileScope profileScope_##zone(zone)
+#else
+#define PROFILE_SCOPE(zone)
+#endif
 
 // ===================================================================
 // PROTÓTIPOS DAS FUNÇÕES
 // ===================================================================
 
 void display();
+void renderFrame();
 void reshape(int w, int h);
 void timer(int value);
 void keyboard(unsigned char key, int x, int y);
 void special(int key, int x, int y);
+void specialUp(int key, int x, int y);
 void init();
-void resetGame();
+void resetGame(unsigned long long seed);
 
 // --- Funções de Desenho ---
 void drawPenguin(const Penguin& p);
+void drawArenaPenguins();
 void drawFish(const Fish& fish);
 void drawHole(const Hole& hole);
 void drawIcePlatform();
 void drawSkybox();
 void drawUI();
 void drawScene();
+void buildFontAtlas();
+bool labelChanged(TextLabel& label, const int* key, int count);
+void layoutLabel(TextLabel& label, const char* text);
+void drawLabel(const TextLabel& label, float x, float y, float scale);
 
 // --- Funções Auxiliares ---
 void setMaterial(float r, float g, float b, float shininess);
+int internMaterial(const Material& m);
+Material makeMaterial(float r, float g, float b, float shininess);
+void applyMaterial(int id);
+void invalidateStateCache();
+void setLighting(bool enabled);
+void setDepthTest(bool enabled);
+void setDepthMask(bool enabled);
+void beginRenderQueue();
+void submitMesh(const Mesh& mesh);
+bool initShaderBackend();
+void setProgram(GLuint program);
+void updateFrameUniforms();
+void setSceneMatrices(const float* modelview);
+void flushRenderQueue();
 void drawEllipsoid(float rx, float ry, float rz);
-bool checkCollision(Position p1, float r1, Position p2, float r2);
+void buildMeshes();
+void drawMesh(const Mesh& mesh);
+void initInstancing();
+void drawFishInstanced(const FishPool& fishes);
+void drawHolesInstanced(const HolePool& holes);
+void updateViewFrustum(int viewportHeight);
+int cullEntity(float x, float y, float z, float radius);
+bool checkCollision(const Position& p1, float r1, const Position& p2, float r2);
+Fish fishAt(const FishPool& fishes, int i);
+Hole holeAt(const HolePool& holes, int i);
+
+// --- Núcleo da Simulação (sem janela) ---
+void resetWorld(GameWorld& w, unsigned long long seed);
+bool spawnFish(GameWorld& w);
+bool spawnHole(GameWorld& w);
+bool findSpawnPoint(GameWorld& w, int kind, const float* anchorX, const float* anchorZ, int anchors,
+                    float& x, float& z);
+void simulateStep(GameWorld& w, float deltaTime);
+void resolveCollisions(GameWorld& w);
+void updateSpawners(GameWorld& w);
+void applyAction(GameWorld& w, int action, float deltaTime);
+int countSteps(float value, float delta, float limit);
+void scheduleWorldTimers(GameWorld& w);
+void handleTimer(GameWorld& w, const FiredTimer& t);
+void refillBabyEnergy(GameWorld& w);
+void despawnFish(GameWorld& w, int dense);
+void despawnHole(GameWorld& w, int dense);
+void advanceWorld(GameWorld& w, float deltaTime);
+void animatePenguin(Penguin& penguin, float deltaTime);
+void movePenguin(Penguin& penguin, int action, const GameParams& params, float deltaTime);
+void controlPenguin(Penguin& penguin, int keys, const GameParams& params, float deltaTime);
+bool penguinInHole(const HolePool& holes, const SpatialGrid& holeGrid, const Position& pos,
+                   std::vector<int>& query, CandidateBatch& candidates);
+int fishInReach(const FishPool& fishes, const SpatialGrid& fishGrid, const Position& pos,
+                std::vector<int>& query, CandidateBatch& candidates);
+bool deliverFish(Penguin& mother, const Penguin& baby);
+
+// --- Sistema de Tarefas e Execução em Lote ---
+void startJobSystem(int numThreads);
+void stopJobSystem();
+void jobWorkerLoop(int worker);
+void parallelFor(int numJobs, JobFunction function, void* context);
+bool parseSweep(const char* spec);
+int runHeadless(int numGames);
+
+// --- Ambiente Vetorizado ---
+void initVecEnv(VecEnv& e, int numEnvs, const GameParams& params);
+void resetVecEnv(VecEnv& e, unsigned long long seed, float* observations);
+void stepVecEnv(VecEnv& e, const int* actions, float* observations, float* rewards, unsigned char* dones);
+void writeObservation(const GameWorld& w, float* obs);
+int runEnvBenchmark(int numEnvs, int numSteps);
+
+// --- Piloto Automático ---
+bool planPath(const OccupancyGrid& grid, PathPlanner& planner, int start, int goal, std::vector<int>& path);
+void resetAutopilot(AutopilotAgent& a, const GameWorld& w);
+int autopilotControls(AutopilotAgent& a, const GameWorld& w, float deltaTime);
+int steerControls(const Penguin& penguin, float targetX, float targetZ, const GameParams& params, float deltaTime);
+int runPlannerBenchmark(int gridSize, int numPlans);
+
+// --- Benchmarks ---
+int runBenchmarks();
+
+// --- Arena com Muitos Pinguins ---
+void resetArena(ArenaWorld& a, int numPairs, unsigned long long seed);
+void syncArenaPenguins(ArenaWorld& a);
+void resolveArenaClaims(ArenaWorld& a);
+unsigned long long arenaChecksum(const ArenaWorld& a);
+void stepArena(ArenaWorld& a);
+Penguin arenaPenguin(const ArenaWorld& a, int i, bool baby);
+int runArena(int numPairs, int numSteps);
+
+// --- Aleatoriedade Determinística, Gravação e Replay ---
+void seedRng(GameRng& rng, unsigned long long seed);
+float randomFloat(GameRng& rng);
+void queueInput(int type, int action, unsigned long long seed);
+void applyControls(GameWorld& w, int keys, float deltaTime);
+void recordInputLatency(double swapTime, long long shownStep);
+void applyInputsForStep();
+void advanceSession();
+void writeInputLog();
+bool readInputLog(const char* path, unsigned long long& seed);
+unsigned long long hashBytes(unsigned long long h, const void* data, size_t size);
+unsigned long long hashPenguin(unsigned long long h, const Penguin& p);
+unsigned long long worldChecksum(const GameWorld& w);
+int runReplayHeadless();
+
+// --- Renderização Fora da Tela e Captura ---
+int runOffscreen(int numFrames);
+
+// --- Arena do Quadro e Contagem de Alocações ---
+int runAllocationCheck(int numFrames);
+
+// --- Retratos do Mundo e Thread da Simulação ---
+void captureWorld(const GameWorld& w, const Penguin& prevMother, const Penguin& prevBaby, long long step,
+                  WorldSnapshot& s);
+void publishSnapshot(SnapshotBuffer& buffer);
+void publishWorld(double simClock);
+const WorldSnapshot& acquireSnapshot(SnapshotBuffer& buffer);
+unsigned long long snapshotChecksum(const WorldSnapshot& s);
+void startSimThread();
+void stopSimThread();
+void simThreadLoop();
+int runSnapshotStress(int publications);
+
+// --- Kernels em Lote (SIMD) ---
+typedef int (*SphereHitMaskFn)(float cx, float cy, float cz, float r,
+                               const float* xs, const float* ys, const float* zs, const float* radii,
+                               int n, unsigned char* mask);
+typedef void (*AddBatchFn)(float* values, float amount, int n);
+typedef void (*FishAnimationBatchFn)(const float* animationTime, const float* bobHeight, float timeOffset,
+                                     int n, float* bobOffset, float* yaw);
+extern SphereHitMaskFn sphereHitMask;
+extern AddBatchFn addBatch;
+extern FishAnimationBatchFn fishAnimationBatch;
+void initKernels(const char* requested);
+int checkKernels();
+template <int N>
+int testCandidates(const std::vector<int>& query, CandidateBatch& candidates, const EntityPool<N>& pool,
+                   int colX, int colY, int colZ, int colRadius, const Position& p, float r);
+
+// --- Loop de Passo Fixo e Telemetria ---
+double nowSeconds();
+Penguin interpolatePenguin(const Penguin& prev, const Penguin& cur, float alpha);
+void recordFrame();
+void printFrameTelemetry();
+
+// --- Ritmo dos Quadros ---
+int applySwapInterval(int interval);
+void scheduleNextFrame(double now);
+void wakePacer();
+bool sceneStatic();
+bool simIdleLocked();
+void setPaused(bool paused);
+void visibility(int state);
+
+// --- Profiler de Quadro ---
+void profileEndFrame();
+void drawProfilerHud(int windowWidth, int windowHeight);
+void writeProfile();
 
 // ===================================================================
 // FUNÇÃO PRINCIPAL
 // ===================================================================
 
+#ifndef PENGUIN_ENV_LIBRARY
 int main(int argc, char** argv) {
+    // --- Modo sem janela: simula jogos completos o mais rápido possível ---
+    bool headless = false;
+    bool offscreen = false;
+    int numFrames = 300;
+    bool checkKernelsOnly = false;
+    const char* simdRequested = NULL;
+    int numGames = 1;
+    int numThreads = 0;
+    int arenaPairs = 0;
+    int arenaSteps = 1000;
+    int plannerGrid = 0;
+    int numPlans = 10000;
+    bool benchmarks = false;
+    int stressPublications = 0;
+    bool checkAllocs = false;
+    int envCount = 0;
+    int envSteps = 10000;
+    unsigned long long seed = time(NULL);
+    world.params = DEFAULT_GAME_PARAMS;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) headless = true;
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) numGames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frame-log") == 0 && i + 1 < argc) frameLogPath = argv[++i];
+        else if (strcmp(argv[i], "--max-fish") == 0 && i + 1 < argc) world.params.maxFish = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--max-holes") == 0 && i + 1 < argc) world.params.maxHoles = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--hole-lifetime") == 0 && i + 1 < argc) world.params.holeLifetime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) simdRequested = argv[++i];
+        else if (strcmp(argv[i], "--check-kernels") == 0) checkKernelsOnly = true;
+        else if (strcmp(argv[i], "--no-instancing") == 0) useInstancing = false;
+        else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc)
+            rendererBackend = strcmp(argv[++i], "shader") == 0 ? RENDERER_SHADER : RENDERER_FIXED;
+        else if (strcmp(argv[i], "--no-culling") == 0) cullingEnabled = false;
+        else if (strcmp(argv[i], "--no-lod") == 0) lodEnabled = false;
+        else if (strcmp(argv[i], "--profile") == 0) profilerEnabled = true;
+        else if (strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc) profileOutputPath = argv[++i];
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) { if (!parseSweep(argv[++i])) return 1; }
+        else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc) arenaPairs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--arena-steps") == 0 && i + 1 < argc) arenaSteps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--offscreen") == 0) offscreen = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) numFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &windowWidth, &windowHeight);
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) capturePrefix = argv[++i];
+        else if (strcmp(argv[i], "--autopilot") == 0) autopilotEnabled = true;
+        else if (strcmp(argv[i], "--bench-planner") == 0 && i + 1 < argc) plannerGrid = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--plans") == 0 && i + 1 < argc) numPlans = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0) benchmarks = true;
+        else if (strcmp(argv[i], "--bench-filter") == 0 && i + 1 < argc) benchFilter = argv[++i];
+        else if (strcmp(argv[i], "--bench-samples") == 0 && i + 1 < argc) benchSamples = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) benchOutputPath = argv[++i];
+        else if (strcmp(argv[i], "--bench-baseline") == 0 && i + 1 < argc) benchBaselinePath = argv[++i];
+        else if (strcmp(argv[i], "--bench-threshold") == 0 && i + 1 < argc) benchRegressionThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) capturePng = strcmp(argv[++i], "png") == 0;
+        else if (strcmp(argv[i], "--no-sim-thread") == 0) useSimThread = false;
+        else if (strcmp(argv[i], "--stress-snapshots") == 0 && i + 1 < argc) stressPublications = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--check-allocs") == 0) checkAllocs = true;
+        else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) frameCap = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) vsyncRequested = strcmp(argv[++i], "off") != 0;
+        else if (strcmp(argv[i], "--env") == 0 && i + 1 < argc) envCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--env-steps") == 0 && i + 1 < argc) envSteps = atoi(argv[++i]);
+    }
+    initKernels(simdRequested);
+    if (checkKernelsOnly) {
+        return checkKernels();
+    }
+    if (replayPath && !readInputLog(replayPath, seed)) return 1;
+    world.seed = recordSeed = seed;
+    worldSnapshots.reset();
+    if (stressPublications > 0) {
+        return runSnapshotStress(stressPublications);
+    }
+    if (benchmarks) {
+        return runBenchmarks();
+    }
+    if (plannerGrid > 0) {
+        startJobSystem(numThreads);
+        int result = runPlannerBenchmark(plannerGrid, numPlans);
+        stopJobSystem();
+        return result;
+    }
+    if (envCount > 0) {
+        if (envSteps < 1) {
+            fprintf(stderr, "--env-steps deve ser pelo menos 1 (recebido %d)\n", envSteps);
+            return 1;
+        }
+        startJobSystem(numThreads);
+        int result = runEnvBenchmark(envCount, envSteps);
+        stopJobSystem();
+        writeProfile();
+        return result;
+    }
+    if (arenaPairs > 0 && !offscreen) {
+        startJobSystem(numThreads);
+        int result = runArena(arenaPairs, arenaSteps);
+        stopJobSystem();
+        writeProfile();
+        return result;
+    }
+    if (headless) {
+        int result;
+        if (replayPath) {
+            resetGame(world.seed);
+            result = runReplayHeadless();
+        } else {
+            startJobSystem(numThreads);
+            result = runHeadless(numGames);
+            stopJobSystem();
+        }
+        writeProfile();
+        return result;
+    }
+    if (checkAllocs) {
+        return runAllocationCheck(numFrames);
+    }
+    if (offscreen) {
+        if (arenaPairs > 0) {
+            startJobSystem(numThreads);
+            resetArena(arena, arenaPairs, world.seed);
+            arenaView = true;
+        }
+        int result = runOffscreen(numFrames);
+        if (arenaView) stopJobSystem();
+        writeProfile();
+        return result;
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_MULTISAMPLE);
-    glutInitWindowSize(1024, 768);
+    glutInitWindowSize(windowWidth, windowHeight);
     glutInitWindowPosition(100, 100);
     glutCreateWindow("Missão de Resgate do Pinguim");
 
     init();
-    resetGame();
+    swapInterval = applySwapInterval(vsyncRequested ? 1 : 0);
+    if (frameCap > 0) printf("Ritmo: ate %d quadros/s", frameCap);
+    else printf("Ritmo: sem limite de quadros/s");
+    if (swapInterval >= 0) printf(", vsync %s (%s)\n", swapInterval > 0 ? "ligado" : "desligado", swapControl);
+    else printf(", vsync do driver (sem controle do intervalo de troca)\n");
+    resetGame(world.seed);
+    lastFrameClock = nowSeconds();
+    nextFrameDeadline = lastFrameClock;
+    publishWorld(lastFrameClock);
+    atexit(printFrameTelemetry);
+    atexit(writeProfile);
+    atexit(writeInputLog);
+    if (useSimThread) {
+        startSimThread();
+        atexit(stopSimThread); // Registrada por último: roda antes das outras, com a simulação parada
+    }
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
-    glutTimerFunc(16, timer, 0);
+    glutVisibilityFunc(visibility);
+    glutTimerFunc(0, timer, pacerGeneration);
     glutKeyboardFunc(keyboard);
     glutSpecialFunc(special);
+    glutSpecialUpFunc(specialUp);
+    glutIgnoreKeyRepeat(1); // O estado das teclas vem de key-down/key-up, não da repetição do sistema
 
     glutMainLoop();
     return 0;
 }
+#endif
 
 // ===================================================================
 // INICIALIZAÇÃO E ESTADO DO JOGO
@@ -136,7 +1655,6 @@ int main(int argc, char** argv) {
 
 // init: Realiza a inicialização específica da aplicação.
 void init() {
-    srand(time(NULL));
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_LIGHTING);
     glEnable(GL_LIGHT0);
@@ -149,63 +1667,95 @@ void init() {
     glClearColor(0.5f, 0.8f, 1.0f, 1.0f);
 
     // Configura a fonte de luz primária (sol)
-    GLfloat lightPos0[] = {5.0f, 10.0f, 5.0f, 1.0f};
-    GLfloat lightAmbient0[] = {0.4f, 0.4f, 0.4f, 1.0f};
-    GLfloat lightDiffuse0[] = {1.0f, 1.0f, 0.9f, 1.0f};
-    GLfloat lightSpecular0[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glLightfv(GL_LIGHT0, GL_POSITION, lightPos0);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, lightAmbient0);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiffuse0);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, lightSpecular0);
+    glLightfv(GL_LIGHT0, GL_POSITION, SUN_POSITION);
+    glLightfv(GL_LIGHT0, GL_AMBIENT, SUN_AMBIENT);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, SUN_DIFFUSE);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, SUN_SPECULAR);
 
     // Configura a luz de preenchimento para melhor visibilidade
-    GLfloat lightPos1[] = {-5.0f, 8.0f, -5.0f, 1.0f};
-    GLfloat lightDiffuse1[] = {0.6f, 0.6f, 0.8f, 1.0f};
-    glLightfv(GL_LIGHT1, GL_POSITION, lightPos1);
-    glLightfv(GL_LIGHT1, GL_DIFFUSE, lightDiffuse1);
+    glLightfv(GL_LIGHT1, GL_POSITION, FILL_POSITION);
+    glLightfv(GL_LIGHT1, GL_DIFFUSE, FILL_DIFFUSE);
 
     // Configura a névoa para dar profundidade à cena
-    GLfloat fogColor[4] = {0.5, 0.8, 1.0, 1.0};
     glEnable(GL_FOG);
     glFogi(GL_FOG_MODE, GL_LINEAR);
-    glFogfv(GL_FOG_COLOR, fogColor);
-    glFogf(GL_FOG_START, 8.0f);
-    glFogf(GL_FOG_END, 30.0f);
+    glFogfv(GL_FOG_COLOR, FOG_COLOR);
+    glFogf(GL_FOG_START, FOG_START);
+    glFogf(GL_FOG_END, FOG_END);
+
+    materials.reserve(MATERIAL_RESERVE);
+    buildMeshes();
+    buildFontAtlas();
+    if (rendererBackend == RENDERER_SHADER && !initShaderBackend()) {
+        fprintf(stderr, "Backend de shaders indisponivel, usando o pipeline fixo\n");
+        rendererBackend = RENDERER_FIXED;
+    }
+    initInstancing();
+    invalidateStateCache();
 }
 
-// resetGame: Reinicia todas as variáveis do jogo para seus estados iniciais.
-void resetGame() {
-    gameState = 0; // Jogando
+// resetGame: Reinicia a partida da janela com a semente dada e volta à câmera padrão.
+void resetGame(unsigned long long seed) {
+    resetWorld(world, seed);
+    resetAutopilot(autopilot, world);
     cameraSelected = 1; // Visão de câmera padrão
-    gameTime = 0.0f;
-    babyEnergyTime = BABY_ENERGY_MAX;
-    fishSpawnTimer = 0.0f;
-    holeSpawnTimer = 0.0f;
-
-    motherPenguin.pos = {0.0f, 0.48f, 2.0f};
-    motherPenguin.rotation = 0.0f;
-    motherPenguin.hasFish = false;
-    motherPenguin.isMoving = false;
-    motherPenguin.wingAnimation = 0.0f;
-    motherPenguin.isBaby = false;
-
-    babyPenguin.pos = {0.0f, 0.48f, 0.0f};
-    babyPenguin.rotation = 0.0f;
-    babyPenguin.isBaby = true;
-
-    fishes.assign(MAX_FISH, Fish());
-    holes.assign(MAX_HOLES, Hole());
+    prevMotherPenguin = world.motherPenguin;
+    prevBabyPenguin = world.babyPenguin;
 }
 
 // ===================================================================
 // FUNÇÕES DE RENDERIZAÇÃO
 // ===================================================================
 
-// display: Limpa a janela e desenha a cena a partir de uma única viewport que pode ser trocada.
+// display: Desenha o quadro na janela e troca os buffers.
 void display() {
+    double renderStart = nowSeconds();
+    renderFrame();
+
+    double swapStart = nowSeconds();
+    {
+        PROFILE_SCOPE(PROFILE_SWAP);
+        glutSwapBuffers();
+    }
+    double swapEnd = nowSeconds();
+
+    currentFrame.renderMs = (swapStart - renderStart) * 1000.0;
+    currentFrame.swapMs = (swapEnd - swapStart) * 1000.0;
+    currentFrame.intervalMs = lastSwapClock > 0.0 ? (swapEnd - lastSwapClock) * 1000.0 : 0.0;
+    lastSwapClock = swapEnd;
+    lastDrawnStep = renderView->step;
+    redrawRequested = false;
+    if (simThreadRunning) { // O timer não simula mais: o custo da simulação vem dos retratos
+        currentFrame.steps = (int)(renderView->step - lastShownStep);
+        currentFrame.simMs = renderView->simMsTotal - lastShownSimMs;
+        lastShownStep = renderView->step;
+        lastShownSimMs = renderView->simMsTotal;
+    }
+    recordInputLatency(swapEnd, renderView->step);
+    recordFrame();
+}
+
+// renderFrame: Limpa o framebuffer e desenha a cena a partir de uma única viewport que pode ser trocada.
+void renderFrame() {
+    renderView = &acquireSnapshot(worldSnapshots);
+    const WorldSnapshot& view = *renderView;
+    if (simThreadRunning) {
+        renderAlpha = (float)((nowSeconds() - view.simClock) / SIM_DELTA_TIME);
+        renderAlpha = std::min(1.0f, std::max(0.0f, renderAlpha));
+    }
+
+    // Interpola os pinguins entre os dois últimos passos da simulação
+    if (arenaView) {
+        renderMotherPenguin = arenaPenguin(arena, 0, false); // A câmera segue o primeiro par
+    } else {
+        renderMotherPenguin = interpolatePenguin(view.prevMotherPenguin, view.motherPenguin, renderAlpha);
+        renderBabyPenguin = interpolatePenguin(view.prevBabyPenguin, view.babyPenguin, renderAlpha);
+    }
+    const Penguin& mother = renderMotherPenguin;
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    int w = glutGet(GLUT_WINDOW_WIDTH);
-    int h = glutGet(GLUT_WINDOW_HEIGHT);
+    int w = windowWidth;
+    int h = windowHeight;
 
     // --- Configura uma única viewport e projeção ---
     glViewport(0, 0, w, h);
@@ -218,22 +1768,22 @@ void display() {
     // --- Seleciona a visão da câmera com base em cameraSelected ---
     switch(cameraSelected) {
         case 1: // Câmera com vista de cima
-            gluLookAt(motherPenguin.pos.x, 12, motherPenguin.pos.z,
-                      motherPenguin.pos.x, motherPenguin.pos.y, motherPenguin.pos.z,
+            gluLookAt(mother.pos.x, 12, mother.pos.z,
+                      mother.pos.x, mother.pos.y, mother.pos.z,
                       0, 0, -1);
             break;
         case 2: // Câmera ao lado da cena
-            gluLookAt(motherPenguin.pos.x + 8, motherPenguin.pos.y + 3, motherPenguin.pos.z,
-                      motherPenguin.pos.x, motherPenguin.pos.y, motherPenguin.pos.z,
+            gluLookAt(mother.pos.x + 8, mother.pos.y + 3, mother.pos.z,
+                      mother.pos.x, mother.pos.y, mother.pos.z,
                       0, 1, 0);
             break;
         case 3: // Câmera de frente pra cena (Follow Cam)
             { // Usa chaves para criar um novo escopo para variáveis locais
-                float radians = motherPenguin.rotation * M_PI / 180.0f;
+                float radians = mother.rotation * M_PI / 180.0f;
                 float look_dx = sin(radians);
                 float look_dz = cos(radians);
-                gluLookAt(motherPenguin.pos.x - look_dx * 4, motherPenguin.pos.y + 2, motherPenguin.pos.z - look_dz * 4,
-                          motherPenguin.pos.x, motherPenguin.pos.y + 0.5f, motherPenguin.pos.z,
+                gluLookAt(mother.pos.x - look_dx * 4, mother.pos.y + 2, mother.pos.z - look_dz * 4,
+                          mother.pos.x, mother.pos.y + 0.5f, mother.pos.z,
                           0, 1, 0);
             }
             break;
@@ -245,47 +1795,99 @@ void display() {
     // --- Desenha a cena e a UI ---
     drawScene();
     drawUI();
-
-    glutSwapBuffers();
 }
 
 // drawScene: Chama todas as funções necessárias para desenhar o mundo do jogo.
 void drawScene() {
+    PROFILE_SCOPE(PROFILE_DRAW_SCENE);
+    updateViewFrustum(windowHeight);
+    if (rendererBackend == RENDERER_SHADER) updateFrameUniforms();
     drawSkybox();
+
+    beginRenderQueue();
     drawIcePlatform();
-    drawPenguin(motherPenguin);
-    drawPenguin(babyPenguin);
+    if (arenaView) {
+        drawArenaPenguins();
+    } else {
+        drawPenguin(renderMotherPenguin);
+        drawPenguin(renderBabyPenguin);
+    }
 
-    for (int i = 0; i < fishes.size(); ++i) {
-        drawFish(fishes[i]);
+    // Calcula em lote a animação de todos os peixes no instante interpolado
+    const FishPool& fishes = arenaView ? arena.field.fishes : renderView->fishes;
+    const HolePool& holes = arenaView ? arena.field.holes : renderView->holes;
+    fishBobOffsets.clear();
+    fishYaws.clear();
+    fishBobOffsets.resize(fishes.count);
+    fishYaws.resize(fishes.count);
+    if (fishes.count > 0) {
+        float timeOffset = -(1.0f - renderAlpha) * SIM_DELTA_TIME * 3.0f;
+        fishAnimationBatch(fishes.column(FISH_ANIMATION_TIME), fishes.column(FISH_BOB_HEIGHT),
+                           timeOffset, fishes.count, fishBobOffsets.items, fishYaws.items);
     }
-    for (int i = 0; i < holes.size(); ++i) {
-        drawHole(holes[i]);
+    if (!instancingAvailable) {
+        for (int i = 0; i < fishes.count; ++i) {
+            Fish fish = fishAt(fishes, i);
+            fish.bobOffset = fishBobOffsets[i];
+            fish.yaw = fishYaws[i];
+            drawFish(fish);
+        }
+        for (int i = 0; i < holes.count; ++i) {
+            drawHole(holeAt(holes, i));
+        }
+    }
+    flushRenderQueue();
+
+    if (instancingAvailable) {
+        drawFishInstanced(fishes);
+        drawHolesInstanced(holes);
     }
 }
 
 // drawIcePlatform: Desenha a plataforma de gelo principal.
 void drawIcePlatform() {
-    GLfloat iceMaterial[] = {0.9f, 0.95f, 1.0f, 0.9f};
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, iceMaterial);
+    PROFILE_SCOPE(PROFILE_DRAW_PLATFORM);
+    Material ice = {
+        {0.9f, 0.95f, 1.0f, 0.9f},
+        {0.9f, 0.95f, 1.0f, 0.9f},
+        {0.8f, 0.8f, 0.8f, 1.0f},
+        10.0f
+    };
+    currentMaterial = internMaterial(ice);
     glPushMatrix();
     glTranslatef(0.0f, -0.1f, 0.0f);
-    glScalef(ICE_PLATFORM_SIZE, 0.2f, ICE_PLATFORM_SIZE);
-    glutSolidCube(1.0);
+    float size = arenaView ? arena.field.params.icePlatformSize : renderView->icePlatformSize;
+    glScalef(size, 0.2f, size);
+    drawMesh(cubeMesh);
     glPopMatrix();
 }
 
 // drawSkybox: Desenha um skybox colorido simples.
 void drawSkybox() {
+    PROFILE_SCOPE(PROFILE_DRAW_SKYBOX);
     glPushMatrix();
-    glDisable(GL_LIGHTING);
-    glDepthMask(GL_FALSE);
-    glColor3f(0.6f, 0.9f, 1.0f);
+    setLighting(false);
+    setDepthMask(false);
+    glColor3fv(SKY_SIDE_COLOR);
+
+    if (rendererBackend == RENDERER_SHADER) {
+        float modelview[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+        setSceneMatrices(modelview);
+        glUniform1i(sceneInstanceKindLocation, INSTANCE_UNLIT);
+        glBindVertexArray(skyboxVertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, skyboxVertexCount);
+        glBindVertexArray(0);
+        glUniform1i(sceneInstanceKindLocation, INSTANCE_NONE);
+        currentFrame.drawCalls++;
+        glPopMatrix();
+        return;
+    }
 
     // Desenha planos coloridos simples para o céu
-    float size = 20.0f;
-    float height = 30.0f;
-    float bottom = -10.0f;
+    float size = SKYBOX_SIZE;
+    float height = SKYBOX_HEIGHT;
+    float bottom = SKYBOX_BOTTOM;
     glBegin(GL_QUADS);
     // Frente
     glVertex3f(-size, bottom, -size); glVertex3f(size, bottom, -size); glVertex3f(size, height, -size); glVertex3f(-size, height, -size);
@@ -296,48 +1898,74 @@ void drawSkybox() {
     // Direita
     glVertex3f(size, bottom, -size); glVertex3f(size, bottom, size); glVertex3f(size, height, size); glVertex3f(size, height, -size);
     // Topo
-    glColor3f(0.4f, 0.7f, 1.0f);
+    glColor3fv(SKY_TOP_COLOR);
     glVertex3f(-size, height, -size); glVertex3f(size, height, -size); glVertex3f(size, height, size); glVertex3f(-size, height, size);
     glEnd();
 
-    glDepthMask(GL_TRUE);
-    glEnable(GL_LIGHTING);
     glPopMatrix();
 }
 
 // drawUI: Desenha o texto da interface do usuário na tela.
 void drawUI() {
+    PROFILE_SCOPE(PROFILE_DRAW_UI);
+    setProgram(0); // O HUD continua no pipeline fixo nos dois backends
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
     glLoadIdentity();
-    gluOrtho2D(0, glutGet(GLUT_WINDOW_WIDTH), 0, glutGet(GLUT_WINDOW_HEIGHT));
+    gluOrtho2D(0, windowWidth, 0, windowHeight);
     glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
     glLoadIdentity();
 
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
+    setLighting(false);
+    setDepthTest(false);
 
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2f(10, glutGet(GLUT_WINDOW_HEIGHT) - 20);
-    char gameInfo[256];
-    const char* stateStr = (gameState == 0) ? "Jogando" : (gameState == 1) ? "VOCE VENCEU!" : "FIM DE JOGO";
-    sprintf(gameInfo, "Tempo: %.1f | Energia do Bebe: %.1f | Estado: %s", gameTime, babyEnergyTime, stateStr);
-    for (char* c = gameInfo; *c != '\0'; c++) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
+    if (profilerEnabled) {
+        drawProfilerHud(windowWidth, windowHeight);
     }
 
-    if (gameState != 0) {
-        char endMessage[256];
-        sprintf(endMessage, "Pressione 'r' para reiniciar.");
-        glRasterPos2f(glutGet(GLUT_WINDOW_WIDTH) / 2 - 80, glutGet(GLUT_WINDOW_HEIGHT) / 2);
-         for (char* c = endMessage; *c != '\0'; c++) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-        }
+    // Os números entram na chave já arredondados para o que é exibido
+    const WorldSnapshot& view = *renderView;
+    int timeTenths = (int)(view.gameTime * 10.0f + 0.5f);
+    int energyTenths = std::max(0, (int)(view.babyEnergyTime * 10.0f + 0.5f));
+    int statusKey[3] = {timeTenths, energyTenths, view.gameState};
+    char text[256];
+    if (labelChanged(statusLabel, statusKey, 3)) {
+        const char* stateStr = (view.gameState == 0) ? "Jogando" : (view.gameState == 1) ? "VOCE VENCEU!" : "FIM DE JOGO";
+        sprintf(text, "Tempo: %d.%d | Energia do Bebe: %d.%d | Estado: %s",
+                timeTenths / 10, timeTenths % 10, energyTenths / 10, energyTenths % 10, stateStr);
+        layoutLabel(statusLabel, text);
+    }
+    int cullKey[5] = {currentFrame.entitiesDrawn, currentFrame.entitiesCulled,
+                      currentFrame.lodCounts[0], currentFrame.lodCounts[1], currentFrame.lodCounts[2]};
+    if (labelChanged(cullLabel, cullKey, 5)) {
+        sprintf(text, "Desenhados: %d | Fora da vista: %d | LOD: %d/%d/%d",
+                cullKey[0], cullKey[1], cullKey[2], cullKey[3], cullKey[4]);
+        layoutLabel(cullLabel, text);
+    }
+
+    glColor3f(1.0f, 1.0f, 1.0f);
+    drawLabel(statusLabel, 10, windowHeight - 24, 1.0f);
+    drawLabel(cullLabel, 10, windowHeight - 42, 1.0f);
+    if (latencyCount > 0) {
+        int latencyKey[1] = {(int)(inputLatencyMs[(latencyCount - 1) % LATENCY_HISTORY] + 0.5)};
+        if (labelChanged(latencyLabel, latencyKey, 1)) {
+            sprintf(text, "Latencia de entrada: %d ms", latencyKey[0]);
+            layoutLabel(latencyLabel, text);
+        }
+        drawLabel(latencyLabel, 10, windowHeight - 60, 1.0f);
+    }
+
+    if (view.gameState != 0) {
+        int endKey[1] = {0};
+        if (labelChanged(endLabel, endKey, 1)) layoutLabel(endLabel, "Pressione 'r' para reiniciar.");
+        drawLabel(endLabel, windowWidth / 2 - 29 * FONT_CELL_WIDTH, windowHeight / 2, 2.0f);
+    } else if (simPaused.load()) {
+        int pauseKey[1] = {0};
+        if (labelChanged(pauseLabel, pauseKey, 1)) layoutLabel(pauseLabel, "PAUSADO - espaco para continuar");
+        drawLabel(pauseLabel, windowWidth / 2 - 31 * FONT_CELL_WIDTH, windowHeight / 2, 2.0f);
     }
 
-    glEnable(GL_LIGHTING);
-    glEnable(GL_DEPTH_TEST);
     glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
@@ -345,206 +1973,4626 @@ void drawUI() {
 }
 
 // ===================================================================
-// LÓGICA DO JOGO E ATUALIZAÇÕES
+// KERNELS EM LOTE (SIMD)
+//
+// Cada kernel tem uma versão escalar de referência, uma versão SSE2 (base
+// em x86-64) e uma versão AVX2 escolhida em tempo de execução quando a CPU
+// suporta. As três fazem as mesmas operações na mesma ordem e sem FMA,
+// então os resultados devem ser idênticos bit a bit (--check-kernels).
+// ===================================================================
+
+const float TWO_PI_F = 6.28318530717958647692f;
+const float HALF_PI_F = 1.57079632679489661923f;
+const float PI_F = 3.14159265358979323846f;
+
+// sinScalar: Seno aproximado (redução para [-pi/2, pi/2] e polinômio de Taylor
+// até o grau 11), usado como referência pelos kernels vetorizados.
+float sinScalar(float x) {
+    float y = x - rintf(x * (1.0f / TWO_PI_F)) * TWO_PI_F;
+    if (y > HALF_PI_F) y = PI_F - y;
+    if (y < -HALF_PI_F) y = -PI_F - y;
+    float y2 = y * y;
+    float p = -2.50521083854417e-8f;
+    p = p * y2 + 2.75573192239859e-6f;
+    p = p * y2 - 1.98412698412698e-4f;
+    p = p * y2 + 8.33333333333333e-3f;
+    p = p * y2 - 1.66666666666667e-1f;
+    return y + y * y2 * p;
+}
+
+// sphereHitMaskScalar: Testa uma esfera contra n esferas; mask[i] = 1 onde há colisão.
+int sphereHitMaskScalar(float cx, float cy, float cz, float r,
+                        const float* xs, const float* ys, const float* zs, const float* radii,
+                        int n, unsigned char* mask) {
+    int hits = 0;
+    for (int i = 0; i < n; ++i) {
+        float dx = cx - xs[i];
+        float dy = cy - ys[i];
+        float dz = cz - zs[i];
+        float rr = r + radii[i];
+        mask[i] = (dx * dx + dy * dy + dz * dz) < rr * rr;
+        hits += mask[i];
+    }
+    return hits;
+}
+
+// addBatchScalar: Soma amount a n valores (avanço dos tempos de animação).
+void addBatchScalar(float* values, float amount, int n) {
+    for (int i = 0; i < n; ++i) values[i] += amount;
+}
+
+// fishAnimationBatchScalar: Calcula o deslocamento vertical e o giro de n peixes.
+void fishAnimationBatchScalar(const float* animationTime, const float* bobHeight, float timeOffset,
+                              int n, float* bobOffset, float* yaw) {
+    for (int i = 0; i < n; ++i) {
+        float t = animationTime[i] + timeOffset;
+        bobOffset[i] = sinScalar(t * 2.0f) * bobHeight[i];
+        yaw[i] = sinScalar(t * 0.5f) * 30.0f;
+    }
+}
+
+#if defined(__SSE2__)
+// sinSSE2: Mesma aproximação de sinScalar, quatro valores por vez.
+static inline __m128 sinSSE2(__m128 x) {
+    __m128 k = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.0f / TWO_PI_F))));
+    __m128 y = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(TWO_PI_F)));
+    __m128 hi = _mm_cmpgt_ps(y, _mm_set1_ps(HALF_PI_F));
+    y = _mm_or_ps(_mm_and_ps(hi, _mm_sub_ps(_mm_set1_ps(PI_F), y)), _mm_andnot_ps(hi, y));
+    __m128 lo = _mm_cmplt_ps(y, _mm_set1_ps(-HALF_PI_F));
+    y = _mm_or_ps(_mm_and_ps(lo, _mm_sub_ps(_mm_set1_ps(-PI_F), y)), _mm_andnot_ps(lo, y));
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 p = _mm_set1_ps(-2.50521083854417e-8f);
+    p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(2.75573192239859e-6f));
+    p = _mm_sub_ps(_mm_mul_ps(p, y2), _mm_set1_ps(1.98412698412698e-4f));
+    p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(8.33333333333333e-3f));
+    p = _mm_sub_ps(_mm_mul_ps(p, y2), _mm_set1_ps(1.66666666666667e-1f));
+    return _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(y, y2), p));
+}
+
+int sphereHitMaskSSE2(float cx, float cy, float cz, float r,
+                      const float* xs, const float* ys, const float* zs, const float* radii,
+                      int n, unsigned char* mask) {
+    __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy), vcz = _mm_set1_ps(cz), vr = _mm_set1_ps(r);
+    int hits = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 dx = _mm_sub_ps(vcx, _mm_loadu_ps(xs + i));
+        __m128 dy = _mm_sub_ps(vcy, _mm_loadu_ps(ys + i));
+        __m128 dz = _mm_sub_ps(vcz, _mm_loadu_ps(zs + i));
+        __m128 rr = _mm_add_ps(vr, _mm_loadu_ps(radii + i));
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int bits = _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(rr, rr)));
+        for (int j = 0; j < 4; ++j) {
+            mask[i + j] = (bits >> j) & 1;
+            hits += mask[i + j];
+        }
+    }
+    return hits + sphereHitMaskScalar(cx, cy, cz, r, xs + i, ys + i, zs + i, radii + i, n - i, mask + i);
+}
+
+void addBatchSSE2(float* values, float amount, int n) {
+    __m128 va = _mm_set1_ps(amount);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(values + i, _mm_add_ps(_mm_loadu_ps(values + i), va));
+    addBatchScalar(values + i, amount, n - i);
+}
+
+void fishAnimationBatchSSE2(const float* animationTime, const float* bobHeight, float timeOffset,
+                            int n, float* bobOffset, float* yaw) {
+    __m128 vo = _mm_set1_ps(timeOffset);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 t = _mm_add_ps(_mm_loadu_ps(animationTime + i), vo);
+        _mm_storeu_ps(bobOffset + i, _mm_mul_ps(sinSSE2(_mm_mul_ps(t, _mm_set1_ps(2.0f))), _mm_loadu_ps(bobHeight + i)));
+        _mm_storeu_ps(yaw + i, _mm_mul_ps(sinSSE2(_mm_mul_ps(t, _mm_set1_ps(0.5f))), _mm_set1_ps(30.0f)));
+    }
+    fishAnimationBatchScalar(animationTime + i, bobHeight + i, timeOffset, n - i, bobOffset + i, yaw + i);
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PENGUIN_HAS_AVX2 1
+// sinAVX2: Mesma aproximação de sinScalar, oito valores por vez.
+__attribute__((target("avx2")))
+static inline __m256 sinAVX2(__m256 x) {
+    __m256 k = _mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(1.0f / TWO_PI_F))));
+    __m256 y = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(TWO_PI_F)));
+    y = _mm256_blendv_ps(y, _mm256_sub_ps(_mm256_set1_ps(PI_F), y), _mm256_cmp_ps(y, _mm256_set1_ps(HALF_PI_F), _CMP_GT_OQ));
+    y = _mm256_blendv_ps(y, _mm256_sub_ps(_mm256_set1_ps(-PI_F), y), _mm256_cmp_ps(y, _mm256_set1_ps(-HALF_PI_F), _CMP_LT_OQ));
+    __m256 y2 = _mm256_mul_ps(y, y);
+    __m256 p = _mm256_set1_ps(-2.50521083854417e-8f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(2.75573192239859e-6f));
+    p = _mm256_sub_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(1.98412698412698e-4f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(8.33333333333333e-3f));
+    p = _mm256_sub_ps(_mm256_mul_ps(p, y2), _mm256_set1_ps(1.66666666666667e-1f));
+    return _mm256_add_ps(y, _mm256_mul_ps(_mm256_mul_ps(y, y2), p));
+}
+
+__attribute__((target("avx2")))
+int sphereHitMaskAVX2(float cx, float cy, float cz, float r,
+                      const float* xs, const float* ys, const float* zs, const float* radii,
+                      int n, unsigned char* mask) {
+    __m256 vcx = _mm256_set1_ps(cx), vcy = _mm256_set1_ps(cy), vcz = _mm256_set1_ps(cz), vr = _mm256_set1_ps(r);
+    int hits = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 dx = _mm256_sub_ps(vcx, _mm256_loadu_ps(xs + i));
+        __m256 dy = _mm256_sub_ps(vcy, _mm256_loadu_ps(ys + i));
+        __m256 dz = _mm256_sub_ps(vcz, _mm256_loadu_ps(zs + i));
+        __m256 rr = _mm256_add_ps(vr, _mm256_loadu_ps(radii + i));
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        int bits = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(rr, rr), _CMP_LT_OQ));
+        for (int j = 0; j < 8; ++j) {
+            mask[i + j] = (bits >> j) & 1;
+            hits += mask[i + j];
+        }
+    }
+    return hits + sphereHitMaskScalar(cx, cy, cz, r, xs + i, ys + i, zs + i, radii + i, n - i, mask + i);
+}
+
+__attribute__((target("avx2")))
+void addBatchAVX2(float* values, float amount, int n) {
+    __m256 va = _mm256_set1_ps(amount);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(values + i, _mm256_add_ps(_mm256_loadu_ps(values + i), va));
+    addBatchScalar(values + i, amount, n - i);
+}
+
+__attribute__((target("avx2")))
+void fishAnimationBatchAVX2(const float* animationTime, const float* bobHeight, float timeOffset,
+                            int n, float* bobOffset, float* yaw) {
+    __m256 vo = _mm256_set1_ps(timeOffset);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 t = _mm256_add_ps(_mm256_loadu_ps(animationTime + i), vo);
+        _mm256_storeu_ps(bobOffset + i, _mm256_mul_ps(sinAVX2(_mm256_mul_ps(t, _mm256_set1_ps(2.0f))), _mm256_loadu_ps(bobHeight + i)));
+        _mm256_storeu_ps(yaw + i, _mm256_mul_ps(sinAVX2(_mm256_mul_ps(t, _mm256_set1_ps(0.5f))), _mm256_set1_ps(30.0f)));
+    }
+    fishAnimationBatchScalar(animationTime + i, bobHeight + i, timeOffset, n - i, bobOffset + i, yaw + i);
+}
+#endif
+
+// --- Despacho em tempo de execução ---
+SphereHitMaskFn sphereHitMask = sphereHitMaskScalar;
+AddBatchFn addBatch = addBatchScalar;
+FishAnimationBatchFn fishAnimationBatch = fishAnimationBatchScalar;
+const char* simdLevel = "scalar";
+
+// initKernels: Escolhe a melhor implementação disponível, ou a pedida em requested.
+void initKernels(const char* requested) {
+    bool wantScalar = requested && strcmp(requested, "scalar") == 0;
+    bool wantSSE2 = requested && strcmp(requested, "sse2") == 0;
+    sphereHitMask = sphereHitMaskScalar;
+    addBatch = addBatchScalar;
+    fishAnimationBatch = fishAnimationBatchScalar;
+    simdLevel = "scalar";
+    if (wantScalar) return;
+#if defined(__SSE2__)
+    sphereHitMask = sphereHitMaskSSE2;
+    addBatch = addBatchSSE2;
+    fishAnimationBatch = fishAnimationBatchSSE2;
+    simdLevel = "sse2";
+#endif
+    if (wantSSE2) return;
+#if defined(PENGUIN_HAS_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        sphereHitMask = sphereHitMaskAVX2;
+        addBatch = addBatchAVX2;
+        fishAnimationBatch = fishAnimationBatchAVX2;
+        simdLevel = "avx2";
+    }
+#endif
+}
+
+// checkKernels: Compara cada implementação disponível com a referência escalar.
+int checkKernels() {
+    const int n = 1037; // Não múltiplo de 8 para exercitar o resto dos laços
+    std::vector<float> xs(n), ys(n), zs(n), radii(n), anim(n), bob(n);
+    for (int i = 0; i < n; ++i) {
+        xs[i] = (rand() / (float)RAND_MAX - 0.5f) * 4.0f;
+        ys[i] = (rand() / (float)RAND_MAX) * 0.5f;
+        zs[i] = (rand() / (float)RAND_MAX - 0.5f) * 4.0f;
+        radii[i] = 0.1f + (rand() / (float)RAND_MAX) * 0.4f;
+        anim[i] = (rand() / (float)RAND_MAX) * 900.0f;
+        bob[i] = 0.1f + (rand() / (float)RAND_MAX) * 0.2f;
+    }
+
+    std::vector<unsigned char> refMask(n), mask(n);
+    std::vector<float> refBob(n), refYaw(n), refAdd(anim), outBob(n), outYaw(n), outAdd(n);
+    int refHits = sphereHitMaskScalar(0.1f, 0.48f, -0.2f, 0.3f, &xs[0], &ys[0], &zs[0], &radii[0], n, &refMask[0]);
+    fishAnimationBatchScalar(&anim[0], &bob[0], -0.01f, n, &refBob[0], &refYaw[0]);
+    addBatchScalar(&refAdd[0], 0.048f, n);
+
+    // A aproximação do seno também é comparada com sin() da libm
+    float sinError = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float e = fabsf(refYaw[i] - (float)sin((anim[i] - 0.01f) * 0.5f) * 30.0f);
+        if (e > sinError) sinError = e;
+    }
+    int failures = sinError > 1e-2f;
+    printf("scalar: %d colisoes, erro max do seno x libm: %g\n", refHits, sinError);
+
+    const char* levels[] = {"sse2", "avx2"};
+    for (int l = 0; l < 2; ++l) {
+        initKernels(levels[l]);
+        if (strcmp(simdLevel, levels[l]) != 0) {
+            printf("%s: indisponivel\n", levels[l]);
+            continue;
+        }
+        outAdd = anim;
+        int hits = sphereHitMask(0.1f, 0.48f, -0.2f, 0.3f, &xs[0], &ys[0], &zs[0], &radii[0], n, &mask[0]);
+        fishAnimationBatch(&anim[0], &bob[0], -0.01f, n, &outBob[0], &outYaw[0]);
+        addBatch(&outAdd[0], 0.048f, n);
+        bool same = hits == refHits
+            && memcmp(&mask[0], &refMask[0], n) == 0
+            && memcmp(&outBob[0], &refBob[0], n * sizeof(float)) == 0
+            && memcmp(&outYaw[0], &refYaw[0], n * sizeof(float)) == 0
+            && memcmp(&outAdd[0], &refAdd[0], n * sizeof(float)) == 0;
+        printf("%s: %s\n", levels[l], same ? "identico a referencia" : "DIVERGE da referencia");
+        if (!same) failures++;
+    }
+    initKernels(NULL);
+    return failures ? 1 : 0;
+}
+
+// ===================================================================
+// LÓGICA DO JOGO E ATUALIZAÇÕES (NÚCLEO DA SIMULAÇÃO)
+//
+// Nada nesta seção chama GLUT ou OpenGL, para que a simulação possa
+// rodar sem janela (--headless) e mais rápido que o tempo real.
+// ===================================================================
+
+// checkCollision: Verifica a colisão entre duas esferas.
+bool checkCollision(const Position& p1, float r1, const Position& p2, float r2) {
+    float dx = p1.x - p2.x;
+    float dy = p1.y - p2.y;
+    float dz = p1.z - p2.z;
+    return (dx * dx + dy * dy + dz * dz) < (r1 + r2) * (r1 + r2);
+}
+
+// fishAt: Monta a estrutura de um peixe ativo a partir das colunas do pool.
+Fish fishAt(const FishPool& fishes, int i) {
+    Fish f;
+    f.pos = {fishes.columns[FISH_X][i], fishes.columns[FISH_Y][i], fishes.columns[FISH_Z][i]};
+    f.animationTime = fishes.columns[FISH_ANIMATION_TIME][i];
+    f.bobHeight = fishes.columns[FISH_BOB_HEIGHT][i];
+    f.bobOffset = 0.0f;
+    f.yaw = 0.0f;
+    return f;
+}
+
+// holeAt: Monta a estrutura de um buraco ativo a partir das colunas do pool.
+Hole holeAt(const HolePool& holes, int i) {
+    Hole h;
+    h.pos = {holes.columns[HOLE_X][i], holes.columns[HOLE_Y][i], holes.columns[HOLE_Z][i]};
+    h.radius = holes.columns[HOLE_RADIUS][i];
+    h.animationTime = holes.columns[HOLE_ANIMATION_TIME][i];
+    return h;
+}
+
+// testCandidates: Copia os candidatos de uma consulta à grade para colunas contíguas e
+// testa todos de uma vez contra a esfera (p, r). Retorna o número de colisões.
+template <int N>
+int testCandidates(const std::vector<int>& query, CandidateBatch& candidates, const EntityPool<N>& pool,
+                   int colX, int colY, int colZ, int colRadius, const Position& p, float r) {
+    int n = query.size();
+    if ((int)candidates.x.size() < n) {
+        candidates.x.resize(n); candidates.y.resize(n); candidates.z.resize(n);
+        candidates.radius.resize(n); candidates.dense.resize(n); candidates.hit.resize(n);
+    }
+    for (int k = 0; k < n; ++k) {
+        int i = pool.slotToDense[query[k]];
+        candidates.dense[k] = i;
+        candidates.x[k] = pool.columns[colX][i];
+        candidates.y[k] = pool.columns[colY][i];
+        candidates.z[k] = pool.columns[colZ][i];
+        candidates.radius[k] = pool.columns[colRadius][i];
+    }
+    candidates.count = n;
+    if (n == 0) return 0;
+    return sphereHitMask(p.x, p.y, p.z, r, &candidates.x[0], &candidates.y[0], &candidates.z[0],
+                         &candidates.radius[0], n, &candidates.hit[0]);
+}
+
+// ===================================================================
+// AGENDA DE EVENTOS (RODA DE TEMPORIZAÇÃO)
+// ===================================================================
+
+// TimerWheel::reset: Esvazia a roda, que passa a contar a partir do passo start.
+void TimerWheel::reset(long long start, int capacity) {
+    freeEvents.clear();
+    for (int e = (int)events.size() - 1; e >= 0; --e) {
+        if (events[e].bucket >= 0) events[e].generation++; // Handles antigos deixam de valer
+        events[e].bucket = -1;
+        freeEvents.push_back(e);
+    }
+    events.reserve(capacity);
+    freeEvents.reserve(capacity);
+    fired.reserve(capacity);
+    fired.clear();
+    for (int b = 0; b < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; ++b) buckets[b] = -1;
+    now = start;
+    pending = 0;
+}
+
+// TimerWheel::link: Põe o evento na casa do nível mais fino que ainda alcança o seu passo.
+void TimerWheel::link(int e) {
+    TimerEvent& ev = events[e];
+    long long delta = ev.due - now;
+    long long at = ev.due;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1LL << (TIMER_WHEEL_BITS * (level + 1)))) level++;
+    long long horizon = (1LL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > horizon) at = now + horizon; // Longe demais: espera no topo e é reposto ao descer
+    int bucket = level * TIMER_WHEEL_SLOTS + (int)((at >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    ev.bucket = bucket;
+    ev.prev = -1;
+    ev.next = buckets[bucket];
+    if (ev.next >= 0) events[ev.next].prev = e;
+    buckets[bucket] = e;
+}
+
+// TimerWheel::unlink: Tira o evento da lista da sua casa.
+void TimerWheel::unlink(int e) {
+    TimerEvent& ev = events[e];
+    if (ev.prev >= 0) events[ev.prev].next = ev.next; else buckets[ev.bucket] = ev.next;
+    if (ev.next >= 0) events[ev.next].prev = ev.prev;
+    ev.bucket = -1;
+}
+
+// TimerWheel::schedule: Marca um evento para o passo due (no mínimo o próximo).
+TimerHandle TimerWheel::schedule(long long due, int kind, int target) {
+    int e;
+    if (!freeEvents.empty()) {
+        e = freeEvents.back();
+        freeEvents.pop_back();
+    } else {
+        e = events.size();
+        TimerEvent blank = {0, 0, 0, -1, -1, -1, 0};
+        events.push_back(blank);
+    }
+    TimerEvent& ev = events[e];
+    ev.due = due > now ? due : now + 1;
+    ev.kind = kind;
+    ev.target = target;
+    link(e);
+    pending++;
+    TimerHandle handle = {e, ev.generation};
+    return handle;
+}
+
+// TimerWheel::cancel: Desmarca o evento, se ainda estiver pendente, e zera o handle.
+bool TimerWheel::cancel(TimerHandle& handle) {
+    TimerHandle h = handle;
+    handle = NO_TIMER;
+    if (h.event < 0 || h.event >= (int)events.size()) return false;
+    TimerEvent& ev = events[h.event];
+    if (ev.generation != h.generation || ev.bucket < 0) return false; // Já disparou ou foi cancelado
+    unlink(h.event);
+    ev.generation++;
+    freeEvents.push_back(h.event);
+    pending--;
+    return true;
+}
+
+// compareFiredTimers: Ordem de tratamento dos eventos de um mesmo passo.
+bool compareFiredTimers(const FiredTimer& a, const FiredTimer& b) {
+    return a.kind != b.kind ? a.kind < b.kind : a.target < b.target;
+}
+
+// TimerWheel::advance: Anda até o passo step, descendo os eventos das casas cujo bloco
+// chegou e juntando em fired os que vencem.
+void TimerWheel::advance(long long step) {
+    fired.clear();
+    while (now < step) {
+        now++;
+        // Do nível mais alto cujo bloco começa agora até o 1, redistribui a casa corrente
+        int top = 0;
+        while (top < TIMER_WHEEL_LEVELS - 1 && (now & ((1LL << (TIMER_WHEEL_BITS * (top + 1))) - 1)) == 0) top++;
+        for (int level = top; level >= 1; --level) {
+            int bucket = level * TIMER_WHEEL_SLOTS + (int)((now >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+            int e = buckets[bucket];
+            buckets[bucket] = -1;
+            while (e >= 0) {
+                int next = events[e].next;
+                link(e);
+                e = next;
+            }
+        }
+        int bucket = (int)(now & (TIMER_WHEEL_SLOTS - 1));
+        int e = buckets[bucket];
+        buckets[bucket] = -1;
+        while (e >= 0) {
+            TimerEvent& ev = events[e];
+            int next = ev.next;
+            FiredTimer t = {ev.kind, ev.target};
+            fired.push_back(t);
+            ev.bucket = -1;
+            ev.generation++;
+            freeEvents.push_back(e);
+            pending--;
+            e = next;
+        }
+    }
+    if (fired.size() > 1) std::sort(fired.begin(), fired.end(), compareFiredTimers);
+}
+
+// countSteps: Quantos passos de value += delta levam value até limit (>= subindo, <=
+// descendo), somando em float como a simulação soma. -1 se o float parar de andar antes.
+// A soma custa um passo por iteração, então as últimas respostas ficam guardadas: os
+// parâmetros quase nunca mudam entre uma partida e a seguinte.
+int countSteps(float value, float delta, float limit) {
+    struct Entry { float value, delta, limit; int steps; };
+    static thread_local Entry cache[8];
+    static thread_local int cached = 0;
+    for (int i = 0; i < std::min(cached, 8); ++i) {
+        const Entry& c = cache[i];
+        if (c.value == value && c.delta == delta && c.limit == limit) return c.steps;
+    }
+    Entry entry = {value, delta, limit, 0};
+    do {
+        float next = value + delta;
+        if (next == value) { entry.steps = -1; break; }
+        value = next;
+        entry.steps++;
+    } while (delta > 0.0f ? value < limit : value > limit);
+    cache[cached++ % 8] = entry;
+    return entry.steps;
+}
+
+// scheduleWorldTimers: Converte os intervalos da partida em passos e marca os eventos
+// iniciais. Os passos vêm da mesma soma em float que gameTime e babyEnergyTime fazem,
+// então cada evento cai no mesmo passo em que a comparação com o float cairia.
+void scheduleWorldTimers(GameWorld& w) {
+    w.step = 0;
+    w.timers.reset(0, w.params.maxHoles + 8);
+    w.fishSpawnSteps = countSteps(0.0f, SIM_DELTA_TIME, w.params.fishSpawnInterval);
+    w.holeSpawnSteps = countSteps(0.0f, SIM_DELTA_TIME, w.params.holeSpawnInterval);
+    w.energySteps = countSteps(w.params.babyEnergyMax, -SIM_DELTA_TIME, 0.0f);
+    w.holeLifetimeSteps = w.params.holeLifetime > 0.0f ? countSteps(0.0f, SIM_DELTA_TIME, w.params.holeLifetime) : 0;
+    w.fishSpawnDue = w.holeSpawnDue = 0;
+
+    int gameSteps = countSteps(0.0f, SIM_DELTA_TIME, w.params.gameDuration);
+    if (gameSteps > 0) w.timers.schedule(gameSteps, TIMER_GAME_END, -1);
+    w.energyDeadline = NO_TIMER;
+    if (w.energySteps > 0) w.energyDeadline = w.timers.schedule(w.energySteps, TIMER_ENERGY_DEADLINE, -1);
+    if (w.fishSpawnSteps > 0) w.timers.schedule(w.fishSpawnSteps, TIMER_FISH_SPAWN, -1);
+    if (w.holeSpawnSteps > 0) w.timers.schedule(w.holeSpawnSteps, TIMER_HOLE_SPAWN, -1);
+    w.holeExpiry.assign(w.params.maxHoles, NO_TIMER);
+}
+
+// handleTimer: Aplica um evento disparado no passo corrente.
+void handleTimer(GameWorld& w, const FiredTimer& t) {
+    switch (t.kind) {
+        case TIMER_GAME_END:
+            w.gameState = 1; // Vitória
+            break;
+        case TIMER_ENERGY_DEADLINE:
+            w.energyDeadline = NO_TIMER;
+            w.gameState = 2; // Derrota
+            break;
+        case TIMER_HOLE_EXPIRY: {
+            w.holeExpiry[t.target] = NO_TIMER;
+            int dense = w.holes.slotToDense[t.target];
+            if (dense >= 0) despawnHole(w, dense);
+            break;
+        }
+        case TIMER_FISH_SPAWN: // A contagem recomeça no passo do pedido, gerando ou não
+            w.fishSpawnDue++;
+            w.timers.schedule(w.step + w.fishSpawnSteps, TIMER_FISH_SPAWN, -1);
+            break;
+        case TIMER_HOLE_SPAWN:
+            w.holeSpawnDue++;
+            w.timers.schedule(w.step + w.holeSpawnSteps, TIMER_HOLE_SPAWN, -1);
+            break;
+    }
+}
+
+// refillBabyEnergy: Enche a energia do bebê e remarca o prazo da derrota.
+void refillBabyEnergy(GameWorld& w) {
+    w.babyEnergyTime = w.params.babyEnergyMax;
+    w.timers.cancel(w.energyDeadline);
+    if (w.energySteps > 0) w.energyDeadline = w.timers.schedule(w.step + w.energySteps, TIMER_ENERGY_DEADLINE, -1);
+}
+
+// despawnFish: Remove o peixe no índice denso do pool e da grade.
+void despawnFish(GameWorld& w, int dense) {
+    w.fishGrid.remove(w.fishes.denseToSlot[dense]);
+    w.fishes.despawn(dense);
+}
+
+// despawnHole: Remove o buraco no índice denso do pool, da grade e da agenda.
+void despawnHole(GameWorld& w, int dense) {
+    int slot = w.holes.denseToSlot[dense];
+    w.holeGrid.remove(slot);
+    if (slot < (int)w.holeExpiry.size()) w.timers.cancel(w.holeExpiry[slot]);
+    w.holes.despawn(dense);
+}
+
+// resetWorld: Reinicia todas as variáveis da partida para seus estados iniciais.
+void resetWorld(GameWorld& w, unsigned long long seed) {
+    w.seed = seed;
+    seedRng(w.rng, seed);
+    w.gameState = 0; // Jogando
+    w.gameTime = 0.0f;
+    w.babyEnergyTime = w.params.babyEnergyMax;
+    w.fishDelivered = 0;
+
+    w.motherPenguin.pos = {0.0f, PENGUIN_HEIGHT, 2.0f};
+    w.motherPenguin.rotation = 0.0f;
+    w.motherPenguin.hasFish = false;
+    w.motherPenguin.isMoving = false;
+    w.motherPenguin.wingAnimation = 0.0f;
+    w.motherPenguin.isBaby = false;
+
+    w.babyPenguin.pos = {0.0f, PENGUIN_HEIGHT, 0.0f};
+    w.babyPenguin.rotation = 0.0f;
+    w.babyPenguin.hasFish = false;
+    w.babyPenguin.isMoving = false;
+    w.babyPenguin.wingAnimation = 0.0f;
+    w.babyPenguin.isBaby = true;
+
+    float size = w.params.icePlatformSize;
+    w.fishes.reset(w.params.maxFish);
+    w.holes.reset(w.params.maxHoles);
+    w.fishGrid.reset(size, GRID_CELL_SIZE, w.params.maxFish);
+    w.holeGrid.reset(size, GRID_CELL_SIZE, w.params.maxHoles);
+    w.penguinGrid.reset(size, GRID_CELL_SIZE, 2);
+    w.penguinGrid.insert(PENGUIN_MOTHER_ID, w.motherPenguin.pos.x, w.motherPenguin.pos.z, PENGUIN_RADIUS);
+    w.penguinGrid.insert(PENGUIN_BABY_ID, w.babyPenguin.pos.x, w.babyPenguin.pos.z, PENGUIN_RADIUS);
+
+    w.extraPenguins.clear();
+
+    SpawnExclusion center = {0.0f, 0.0f, SPAWN_CENTER_EXCLUSION, 1 << SPAWN_HOLE};
+    w.spawnExclusions.assign(1, center);
+
+    // Uma consulta nunca devolve mais do que o maior pool: reservando aqui, o passo não aloca
+    int largestPool = std::max(w.params.maxFish, w.params.maxHoles) + 2;
+    w.queryResults.reserve(largestPool);
+    CandidateBatch& c = w.candidates;
+    c.x.reserve(largestPool); c.y.reserve(largestPool); c.z.reserve(largestPool);
+    c.radius.reserve(largestPool); c.dense.reserve(largestPool); c.hit.reserve(largestPool);
+
+    scheduleWorldTimers(w);
+}
+
+// poolTooClose: Verifica se alguma entidade do pool fica a menos de minDistance de (x, z).
+template <int N>
+bool poolTooClose(GameWorld& w, const SpatialGrid& grid, const EntityPool<N>& pool, int colX, int colZ,
+                  float x, float z, float minDistance) {
+    std::vector<int>& queryResults = w.queryResults;
+    queryResults.clear();
+    grid.query(x, z, minDistance, queryResults);
+    for (int k = 0; k < (int)queryResults.size(); ++k) {
+        int i = pool.slotToDense[queryResults[k]];
+        float dx = pool.columns[colX][i] - x, dz = pool.columns[colZ][i] - z;
+        if (dx * dx + dz * dz < minDistance * minDistance) return true;
+    }
+    return false;
+}
+
+// spawnBlocked: Verifica se um tipo de entidade pode nascer em (x, z).
+bool spawnBlocked(GameWorld& w, int kind, float x, float z) {
+    const float* minDistance = SPAWN_MIN_DISTANCE[kind];
+    for (int k = 0; k < (int)w.spawnExclusions.size(); ++k) {
+        const SpawnExclusion& e = w.spawnExclusions[k];
+        float dx = e.x - x, dz = e.z - z;
+        if ((e.kinds & (1 << kind)) && dx * dx + dz * dz < e.radius * e.radius) return true;
+    }
+    const Penguin* penguins[2] = {&w.motherPenguin, &w.babyPenguin};
+    for (int k = 0; k < 2; ++k) {
+        float dx = penguins[k]->pos.x - x, dz = penguins[k]->pos.z - z;
+        if (dx * dx + dz * dz < minDistance[SPAWN_PENGUIN] * minDistance[SPAWN_PENGUIN]) return true;
+    }
+    if (!w.extraPenguins.empty()) {
+        std::vector<int>& queryResults = w.queryResults;
+        queryResults.clear();
+        w.extraPenguinGrid.query(x, z, minDistance[SPAWN_PENGUIN], queryResults);
+        for (int k = 0; k < (int)queryResults.size(); ++k) {
+            const Position& p = w.extraPenguins[queryResults[k]];
+            float dx = p.x - x, dz = p.z - z;
+            if (dx * dx + dz * dz < minDistance[SPAWN_PENGUIN] * minDistance[SPAWN_PENGUIN]) return true;
+        }
+    }
+    return poolTooClose(w, w.fishGrid, w.fishes, FISH_X, FISH_Z, x, z, minDistance[SPAWN_FISH])
+        || poolTooClose(w, w.holeGrid, w.holes, HOLE_X, HOLE_Z, x, z, minDistance[SPAWN_HOLE]);
+}
+
+// findSpawnPoint: Procura em até SPAWN_ATTEMPTS candidatos um ponto livre para o tipo dado.
+// Depois dos candidatos uniformes, tenta o anel [d, 2d] em volta de uma entidade do mesmo
+// tipo (como no algoritmo de Bridson), onde ficam as lacunas de uma plataforma densa.
+bool findSpawnPoint(GameWorld& w, int kind, const float* anchorX, const float* anchorZ, int anchors,
+                    float& x, float& z) {
+    float size = w.params.icePlatformSize;
+    float half = size * SPAWN_AREA_FRACTION / 2.0f;
+    float spacing = SPAWN_MIN_DISTANCE[kind][kind];
+    for (int attempt = 0; attempt < SPAWN_ATTEMPTS; ++attempt) {
+        if (attempt < SPAWN_UNIFORM_ATTEMPTS || anchors == 0) {
+            x = (randomFloat(w.rng) - 0.5f) * size * SPAWN_AREA_FRACTION;
+            z = (randomFloat(w.rng) - 0.5f) * size * SPAWN_AREA_FRACTION;
+        } else {
+            int a = std::min((int)(randomFloat(w.rng) * anchors), anchors - 1);
+            float angle = randomFloat(w.rng) * 2.0f * (float)M_PI;
+            float r = spacing * (1.0f + randomFloat(w.rng));
+            x = anchorX[a] + r * cosf(angle);
+            z = anchorZ[a] + r * sinf(angle);
+            if (fabsf(x) > half || fabsf(z) > half) continue;
+        }
+        if (!spawnBlocked(w, kind, x, z)) return true;
+    }
+    return false;
+}
+
+// spawnFish: Pega um slot livre do pool e gera um peixe em um local livre. Retorna
+// falso se o pool está cheio ou nenhum candidato respeitou as distâncias mínimas.
+bool spawnFish(GameWorld& w) {
+    FishPool& fishes = w.fishes;
+    if (fishes.freeSlots.empty()) return false; // Pool cheio
+
+    float size = w.params.icePlatformSize;
+    float x, z;
+    if (legacySpawner) {
+        x = (randomFloat(w.rng) - 0.5f) * size * 0.8f;
+        z = (randomFloat(w.rng) - 0.5f) * size * 0.8f;
+    } else if (!findSpawnPoint(w, SPAWN_FISH, fishes.column(FISH_X), fishes.column(FISH_Z), fishes.count, x, z)) {
+        return false;
+    }
+    int i = fishes.spawn();
+    fishes.columns[FISH_X][i] = x;
+    fishes.columns[FISH_Y][i] = 0.3f;
+    fishes.columns[FISH_Z][i] = z;
+    fishes.columns[FISH_RADIUS][i] = 0.2f;
+    fishes.columns[FISH_ANIMATION_TIME][i] = 0.0f;
+    fishes.columns[FISH_BOB_HEIGHT][i] = 0.1f + randomFloat(w.rng) * 0.2f;
+    w.fishGrid.insert(fishes.denseToSlot[i], x, z, 0.2f);
+    return true;
+}
+
+// spawnHole: Pega um slot livre do pool e gera um buraco em um local livre. Retorna
+// falso se o pool está cheio ou nenhum candidato respeitou as distâncias mínimas.
+bool spawnHole(GameWorld& w) {
+    HolePool& holes = w.holes;
+    if (holes.freeSlots.empty()) return false; // Pool cheio
+
+    float size = w.params.icePlatformSize;
+    float x, z;
+    if (legacySpawner) {
+        do {
+            x = (randomFloat(w.rng) - 0.5f) * size * 0.8f;
+            z = (randomFloat(w.rng) - 0.5f) * size * 0.8f;
+        } while (sqrt(x*x + z*z) < 2.0f); // Mantém longe do centro
+    } else if (!findSpawnPoint(w, SPAWN_HOLE, holes.column(HOLE_X), holes.column(HOLE_Z), holes.count, x, z)) {
+        return false;
+    }
+    int i = holes.spawn();
+    holes.columns[HOLE_X][i] = x;
+    holes.columns[HOLE_Y][i] = 0.0f;
+    holes.columns[HOLE_Z][i] = z;
+    holes.columns[HOLE_RADIUS][i] = 0.4f;
+    holes.columns[HOLE_ANIMATION_TIME][i] = 0.0f;
+    int slot = holes.denseToSlot[i];
+    w.holeGrid.insert(slot, x, z, 0.4f);
+    if (w.holeLifetimeSteps > 0 && slot < (int)w.holeExpiry.size())
+        w.holeExpiry[slot] = w.timers.schedule(w.step + w.holeLifetimeSteps, TIMER_HOLE_EXPIRY, slot);
+    return true;
+}
+
+// penguinInHole: Verifica se um pinguim em pos caiu em algum buraco. query e candidates
+// são buffers de quem chama, para que várias threads consultem a mesma plataforma.
+bool penguinInHole(const HolePool& holes, const SpatialGrid& holeGrid, const Position& pos,
+                   std::vector<int>& query, CandidateBatch& candidates) {
+    query.clear();
+    holeGrid.query(pos.x, pos.z, MOTHER_HOLE_REACH, query);
+    return testCandidates(query, candidates, holes, HOLE_X, HOLE_Y, HOLE_Z, HOLE_RADIUS, pos, MOTHER_HOLE_REACH) > 0;
+}
+
+// fishInReach: Índice denso do primeiro peixe ao alcance do bico da mãe em pos, ou -1.
+int fishInReach(const FishPool& fishes, const SpatialGrid& fishGrid, const Position& pos,
+                std::vector<int>& query, CandidateBatch& candidates) {
+    query.clear();
+    fishGrid.query(pos.x, pos.z, MOTHER_FISH_REACH, query);
+    if (testCandidates(query, candidates, fishes, FISH_X, FISH_Y, FISH_Z, FISH_RADIUS, pos, MOTHER_FISH_REACH) == 0) {
+        return -1;
+    }
+    for (int k = 0; k < candidates.count; ++k) {
+        if (candidates.hit[k]) return candidates.dense[k];
+    }
+    return -1;
+}
+
+// deliverFish: Entrega o peixe que a mãe carrega se o bebê está ao alcance. Retorna
+// verdadeiro na entrega; quem chama enche a energia do bebê e conta o peixe.
+bool deliverFish(Penguin& mother, const Penguin& baby) {
+    if (!mother.hasFish || !checkCollision(mother.pos, MOTHER_BABY_REACH, baby.pos, PENGUIN_RADIUS)) return false;
+    mother.hasFish = false;
+    return true;
+}
+
+// resolveCollisions: Trata buraco, peixe e bebê, consultando a grade só ao redor do pinguim mãe.
+void resolveCollisions(GameWorld& w) {
+    PROFILE_SCOPE(PROFILE_COLLISION);
+    Penguin& motherPenguin = w.motherPenguin;
+    if (penguinInHole(w.holes, w.holeGrid, motherPenguin.pos, w.queryResults, w.candidates)) {
+        w.gameState = 2; // Derrota
+    }
+    if (!motherPenguin.hasFish) {
+        int i = fishInReach(w.fishes, w.fishGrid, motherPenguin.pos, w.queryResults, w.candidates);
+        if (i >= 0) {
+            despawnFish(w, i);
+            motherPenguin.hasFish = true;
+        }
+    }
+    if (deliverFish(motherPenguin, w.babyPenguin)) {
+        refillBabyEnergy(w);
+        w.fishDelivered++;
+    }
+}
+
+// updateSpawners: Cria os peixes e buracos que a agenda pediu neste passo (um por
+// pedido; só a arena, com um pedido por par, tem vários no mesmo passo).
+void updateSpawners(GameWorld& w) {
+    PROFILE_SCOPE(PROFILE_SPAWN);
+    for (; w.fishSpawnDue > 0; w.fishSpawnDue--) spawnFish(w);
+    for (; w.holeSpawnDue > 0; w.holeSpawnDue--) spawnHole(w);
+}
+
+// advanceWorld: Avança o relógio e a plataforma de w em um passo: dispara o que a agenda
+// marcou (fim de jogo, prazo da energia, buracos que se fecham e pedidos de geração,
+// atendidos depois das colisões) e anima peixes e buracos.
+void advanceWorld(GameWorld& w, float deltaTime) {
+    w.gameTime += deltaTime;
+    w.babyEnergyTime -= deltaTime;
+    w.step++;
+    {
+        PROFILE_SCOPE(PROFILE_TIMERS);
+        w.timers.advance(w.step);
+        for (int i = 0; i < (int)w.timers.fired.size(); ++i) handleTimer(w, w.timers.fired[i]);
+    }
+    addBatch(w.fishes.column(FISH_ANIMATION_TIME), deltaTime * 3.0f, w.fishes.count);
+    addBatch(w.holes.column(HOLE_ANIMATION_TIME), deltaTime * 2.0f, w.holes.count);
+}
+
+// animatePenguin: Bate as asas do pinguim enquanto ele anda ou gira.
+void animatePenguin(Penguin& penguin, float deltaTime) {
+    if (penguin.isMoving) {
+        penguin.wingAnimation += deltaTime * 8.0f;
+    }
+}
+
+// simulateStep: Avança o estado do jogo em um passo de deltaTime segundos.
+void simulateStep(GameWorld& w, float deltaTime) {
+    if (w.gameState != 0) return; // Só atualiza com o jogo em andamento
+    PROFILE_SCOPE(PROFILE_SIM_STEP);
+
+    advanceWorld(w, deltaTime);
+    animatePenguin(w.motherPenguin, deltaTime);
+
+    // Verifica colisões e controla a geração de objetos
+    resolveCollisions(w);
+    updateSpawners(w);
+}
+
+// controlPenguin: Aplica a um pinguim durante um passo as teclas de controle seguradas.
+// Girar e andar se combinam; teclas opostas se anulam; sem nenhuma, ele fica parado.
+void controlPenguin(Penguin& penguin, int keys, const GameParams& params, float deltaTime) {
+    int turn = ((keys & CONTROL_TURN_LEFT) ? 1 : 0) - ((keys & CONTROL_TURN_RIGHT) ? 1 : 0);
+    int move = ((keys & CONTROL_FORWARD) ? 1 : 0) - ((keys & CONTROL_BACKWARD) ? 1 : 0);
+    if (turn == 0 && move == 0) {
+        movePenguin(penguin, ACTION_NONE, params, deltaTime);
+        return;
+    }
+    if (turn != 0) movePenguin(penguin, turn > 0 ? ACTION_TURN_LEFT : ACTION_TURN_RIGHT, params, deltaTime);
+    if (move != 0) movePenguin(penguin, move > 0 ? ACTION_FORWARD : ACTION_BACKWARD, params, deltaTime);
+}
+
+// movePenguin: Move ou gira um pinguim de acordo com uma ação de controle e o mantém
+// dentro da plataforma.
+void movePenguin(Penguin& penguin, int action, const GameParams& params, float deltaTime) {
+    float speed = params.penguinSpeed;
+    float radians = penguin.rotation * M_PI / 180.0f;
+    float dx = -sin(radians);
+    float dz = -cos(radians);
+
+    penguin.isMoving = true;
+
+    switch (action) {
+        case ACTION_BACKWARD:
+            penguin.pos.x += dx * speed * deltaTime;
+            penguin.pos.z += dz * speed * deltaTime;
+            break;
+        case ACTION_FORWARD:
+            penguin.pos.x -= dx * speed * deltaTime;
+            penguin.pos.z -= dz * speed * deltaTime;
+            break;
+        case ACTION_TURN_LEFT:
+            penguin.rotation += params.rotationSpeed * deltaTime;
+            break;
+        case ACTION_TURN_RIGHT:
+            penguin.rotation -= params.rotationSpeed * deltaTime;
+            break;
+        default:
+             penguin.isMoving = false;
+             break;
+    }
+
+    // Limita a posição à plataforma
+    float halfPlatform = params.icePlatformSize / 2.0f - PENGUIN_RADIUS;
+    if (penguin.pos.x > halfPlatform) penguin.pos.x = halfPlatform;
+    if (penguin.pos.x < -halfPlatform) penguin.pos.x = -halfPlatform;
+    if (penguin.pos.z > halfPlatform) penguin.pos.z = halfPlatform;
+    if (penguin.pos.z < -halfPlatform) penguin.pos.z = -halfPlatform;
+}
+
+// applyControls: Aplica ao pinguim mãe durante um passo as teclas de controle seguradas.
+void applyControls(GameWorld& w, int keys, float deltaTime) {
+    if (w.gameState != 0) return;
+    controlPenguin(w.motherPenguin, keys, w.params, deltaTime);
+    w.penguinGrid.move(PENGUIN_MOTHER_ID, w.motherPenguin.pos.x, w.motherPenguin.pos.z);
+}
+
+// applyAction: Move ou gira o pinguim mãe de acordo com uma ação de controle.
+void applyAction(GameWorld& w, int action, float deltaTime) {
+    if (w.gameState != 0) return;
+    movePenguin(w.motherPenguin, action, w.params, deltaTime);
+    w.penguinGrid.move(PENGUIN_MOTHER_ID, w.motherPenguin.pos.x, w.motherPenguin.pos.z);
+}
+
+// ===================================================================
+// SISTEMA DE TAREFAS E EXECUÇÃO EM LOTE
+//
+// Cada trabalhador tem sua própria fila de tarefas: tira do fim da sua e,
+// quando ela esvazia, rouba do começo da fila de outro. A thread que chama
+// parallelFor participa como trabalhador 0. O lote distribui pedaços de
+// jogos de cada configuração da varredura; cada trabalhador simula num
+// GameWorld próprio e soma resultados em contadores próprios, então não há
+// estado compartilhado durante a simulação.
+// ===================================================================
+
+// startJobSystem: Cria numThreads - 1 threads trabalhadoras (0 = uma por núcleo).
+void startJobSystem(int numThreads) {
+    if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    jobSystem.numWorkers = numThreads;
+    jobSystem.queues = new JobQueue[numThreads];
+    jobSystem.generation = 0;
+    jobSystem.remaining = 0;
+    jobSystem.quit = false;
+    for (int i = 1; i < numThreads; ++i) {
+        jobSystem.threads.push_back(std::thread(jobWorkerLoop, i));
+    }
+}
+
+// stopJobSystem: Acorda as threads trabalhadoras para que terminem e espera por elas.
+void stopJobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(jobSystem.mutex);
+        jobSystem.quit = true;
+    }
+    jobSystem.wake.notify_all();
+    for (int i = 0; i < (int)jobSystem.threads.size(); ++i) jobSystem.threads[i].join();
+    jobSystem.threads.clear();
+    delete[] jobSystem.queues;
+    jobSystem.queues = NULL;
+}
+
+// popJob: Tira uma tarefa da própria fila ou, se vazia, rouba de outro trabalhador.
+bool popJob(int worker, int& job) {
+    JobQueue& own = jobSystem.queues[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (int k = 1; k < jobSystem.numWorkers; ++k) {
+        JobQueue& victim = jobSystem.queues[(worker + k) % jobSystem.numWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+// runJobs: Executa tarefas até não sobrar nenhuma em fila alguma.
+void runJobs(int worker) {
+    int job;
+    while (popJob(worker, job)) {
+        jobSystem.function(jobSystem.context, job, worker);
+        if (jobSystem.remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(jobSystem.mutex);
+            jobSystem.finished.notify_all();
+        }
+    }
+}
+
+// jobWorkerLoop: Corpo de uma thread trabalhadora; dorme entre um parallelFor e outro.
+void jobWorkerLoop(int worker) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(jobSystem.mutex);
+            jobSystem.wake.wait(lock, [&] { return jobSystem.quit || jobSystem.generation != seen; });
+            if (jobSystem.quit) return;
+            seen = jobSystem.generation;
+        }
+        runJobs(worker);
+    }
+}
+
+// parallelFor: Executa function(context, job, worker) para job em [0, numJobs) e espera todas.
+// Cada trabalhador começa com uma faixa contígua de tarefas.
+void parallelFor(int numJobs, JobFunction function, void* context) {
+    if (numJobs <= 0) return;
+    jobSystem.function = function;
+    jobSystem.context = context;
+    jobSystem.remaining = numJobs;
+    int numWorkers = jobSystem.numWorkers;
+    for (int w = 0; w < numWorkers; ++w) {
+        JobQueue& queue = jobSystem.queues[w];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        int first = (long long)numJobs * w / numWorkers;
+        int last = (long long)numJobs * (w + 1) / numWorkers;
+        // O dono tira do fim, então as tarefas entram em ordem inversa
+        for (int j = last - 1; j >= first; --j) queue.jobs.push_back(j);
+    }
+    {
+        std::lock_guard<std::mutex> lock(jobSystem.mutex);
+        jobSystem.generation++;
+    }
+    jobSystem.wake.notify_all();
+
+    runJobs(0);
+    std::unique_lock<std::mutex> lock(jobSystem.mutex);
+    jobSystem.finished.wait(lock, [] { return jobSystem.remaining.load() == 0; });
+}
+
+// findSweepParam: Procura um parâmetro da varredura pelo nome usado em --sweep.
+const SweepParam* findSweepParam(const char* name) {
+    for (int i = 0; i < NUM_SWEEP_PARAMS; ++i) {
+        if (strcmp(SWEEP_PARAMS[i].name, name) == 0) return &SWEEP_PARAMS[i];
+    }
+    return NULL;
+}
+
+// parseSweep: Lê "nome=v1,v2,..." de --sweep e guarda os valores do parâmetro.
+bool parseSweep(const char* spec) {
+    const char* eq = strchr(spec, '=');
+    std::string name(spec, eq ? eq - spec : strlen(spec));
+    const SweepParam* param = findSweepParam(name.c_str());
+    if (!eq || !param) {
+        fprintf(stderr, "--sweep invalido: %s (parametros:", spec);
+        for (int i = 0; i < NUM_SWEEP_PARAMS; ++i) fprintf(stderr, " %s", SWEEP_PARAMS[i].name);
+        fprintf(stderr, ")\n");
+        return false;
+    }
+    SweepAxis axis;
+    axis.param = param;
+    for (const char* v = eq + 1; *v; ) {
+        char* end;
+        axis.values.push_back(strtod(v, &end));
+        if (end == v) break;
+        v = (*end == ',') ? end + 1 : end;
+    }
+    sweepAxes.push_back(axis);
+    return true;
+}
+
+// setSweepParam: Escreve um valor da varredura no campo correspondente dos parâmetros.
+void setSweepParam(GameParams& params, const SweepParam* param, double value) {
+    char* field = (char*)&params + param->offset;
+    if (param->isInt) *(int*)field = std::max(0, (int)value); // Os inteiros são contagens de pool
+    else *(float*)field = (float)value;
+}
+
+// buildBatchConfigs: Produto cartesiano dos eixos de --sweep sobre os parâmetros base.
+void buildBatchConfigs(const GameParams& base) {
+    batchConfigs.assign(1, BatchConfig());
+    batchConfigs[0].params = base;
+    for (int a = 0; a < (int)sweepAxes.size(); ++a) {
+        std::vector<BatchConfig> expanded;
+        for (int c = 0; c < (int)batchConfigs.size(); ++c) {
+            for (int v = 0; v < (int)sweepAxes[a].values.size(); ++v) {
+                BatchConfig config = batchConfigs[c];
+                setSweepParam(config.params, sweepAxes[a].param, sweepAxes[a].values[v]);
+                expanded.push_back(config);
+            }
+        }
+        batchConfigs.swap(expanded);
+    }
+}
+
+// runBatchJob: Simula um pedaço de jogos de uma configuração no mundo do trabalhador.
+void runBatchJob(void* context, int job, int worker) {
+    BatchRun& run = *(BatchRun*)context;
+    int config = job / run.jobsPerConfig;
+    int first = (job % run.jobsPerConfig) * run.gamesPerJob;
+    int last = std::min(first + run.gamesPerJob, run.gamesPerConfig);
+    GameWorld& w = run.worlds[worker];
+    BatchStats& stats = run.stats[worker * batchConfigs.size() + config];
+    w.params = batchConfigs[config].params;
+
+    AutopilotAgent& pilot = run.pilots[worker];
+
+    for (int g = first; g < last; ++g) {
+        resetWorld(w, run.baseSeed + g); // Cada jogo tem sua própria semente, derivada de --seed
+        if (autopilotEnabled) resetAutopilot(pilot, w);
+        long long steps = 0;
+        while (w.gameState == 0) {
+            if (autopilotEnabled) applyControls(w, autopilotControls(pilot, w, SIM_DELTA_TIME), SIM_DELTA_TIME);
+            simulateStep(w, SIM_DELTA_TIME);
+            steps++;
+        }
+        if (autopilotEnabled) stats.plans += pilot.plans;
+        stats.games++;
+        if (w.gameState == 1) stats.wins++; else stats.losses++;
+        stats.survivalTime += w.gameTime;
+        stats.fishDelivered += w.fishDelivered;
+        stats.steps += steps;
+        stats.checksum ^= worldChecksum(w) + g;
+    }
+}
+
+// runHeadless: Simula numGames jogos completos de cada configuração sem janela, em paralelo,
+// e imprime um resumo por configuração e o total.
+int runHeadless(int numGames) {
+    buildBatchConfigs(world.params);
+    int numConfigs = batchConfigs.size();
+    int numWorkers = jobSystem.numWorkers;
+
+    BatchRun run;
+    run.baseSeed = world.seed;
+    run.gamesPerConfig = numGames;
+    // Pedaços pequenos o bastante para equilibrar a carga, grandes o bastante para diluir o roubo
+    run.gamesPerJob = std::max(1, std::min(64, numGames / (numWorkers * 8)));
+    run.jobsPerConfig = (numGames + run.gamesPerJob - 1) / run.gamesPerJob;
+    run.worlds.resize(numWorkers);
+    run.pilots.resize(numWorkers);
+    run.stats.assign(numWorkers * numConfigs, BatchStats());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallelFor(run.jobsPerConfig * numConfigs, runBatchJob, &run);
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BatchStats total = BatchStats();
+    for (int c = 0; c < numConfigs; ++c) {
+        BatchStats& stats = batchConfigs[c].stats;
+        stats = BatchStats();
+        for (int w = 0; w < numWorkers; ++w) {
+            const BatchStats& part = run.stats[w * numConfigs + c];
+            stats.games += part.games;
+            stats.wins += part.wins;
+            stats.losses += part.losses;
+            stats.survivalTime += part.survivalTime;
+            stats.fishDelivered += part.fishDelivered;
+            stats.steps += part.steps;
+            stats.plans += part.plans;
+            stats.checksum ^= part.checksum;
+        }
+        total.games += stats.games;
+        total.wins += stats.wins;
+        total.losses += stats.losses;
+        total.survivalTime += stats.survivalTime;
+        total.fishDelivered += stats.fishDelivered;
+        total.steps += stats.steps;
+        total.plans += stats.plans;
+        total.checksum ^= stats.checksum;
+
+        if (!sweepAxes.empty()) {
+            printf("[");
+            for (int a = 0; a < (int)sweepAxes.size(); ++a) {
+                const SweepParam* param = sweepAxes[a].param;
+                const char* field = (const char*)&batchConfigs[c].params + param->offset;
+                if (param->isInt) printf("%s%s=%d", a ? " " : "", param->name, *(const int*)field);
+                else printf("%s%s=%g", a ? " " : "", param->name, *(const float*)field);
+            }
+            double n = stats.games > 0 ? stats.games : 1;
+            printf("] Vitorias: %.1f%% | Sobrevivencia media: %.2f s | Peixes entregues: %.2f\n",
+                   stats.wins * 100.0 / n, stats.survivalTime / n, stats.fishDelivered / n);
+        }
+    }
+
+    printf("Jogos: %d | Vitorias: %d | Derrotas: %d\n", total.games, total.wins, total.losses);
+    printf("Tempo medio de jogo: %.2f s | Peixes entregues: %.2f | Passos: %lld\n",
+           total.games > 0 ? total.survivalTime / total.games : 0.0,
+           total.games > 0 ? (double)total.fishDelivered / total.games : 0.0, total.steps);
+    if (autopilotEnabled) {
+        printf("Piloto automatico: %lld planejamentos (%.1f por jogo)\n", total.plans,
+               total.games > 0 ? (double)total.plans / total.games : 0.0);
+    }
+    printf("Tempo real: %.3f s | Threads: %d | Jogos/min: %.0f\n", wallSeconds, numWorkers,
+           wallSeconds > 0.0 ? total.games * 60.0 / wallSeconds : 0.0);
+    printf("Semente: %llu | Checksum: %016llx\n", run.baseSeed, total.checksum);
+    return 0;
+}
+
+// ===================================================================
+// AMBIENTE VETORIZADO PARA TREINO (API C++ E C, --env)
+//
+// Um VecEnv guarda N partidas e as avança com a mesma lógica do timer()
+// (applyControls e simulateStep), em pedaços de ENV_CHUNK partidas
+// distribuídos pelo sistema de tarefas. Ações, observações, recompensas e
+// fins de partida ficam em buffers contíguos de quem chama, indexados pela
+// partida, e são lidos e escritos no lugar. A partida i começa com a
+// semente seed + i e cada recomeço soma N, então o resultado não depende do
+// número de threads. Só uma chamada por vez: o sistema de tarefas é único.
+//
+// Com -DPENGUIN_ENV_LIBRARY o arquivo vira biblioteca, sem main:
+//   g++ -shared -fPIC -fvisibility=hidden -DPENGUIN_ENV_LIBRARY -O2 T2.cpp
+//       -o libpenguin_env.so -lX11 -lGL -lGLU -lglut -lEGL -pthread
+// e só as funções penguin_env_* ficam visíveis.
+// ===================================================================
+
+// initVecEnv: Cria numEnvs partidas com os parâmetros dados; ainda precisam de resetVecEnv.
+void initVecEnv(VecEnv& e, int numEnvs, const GameParams& params) {
+    e.numEnvs = numEnvs;
+    e.params = params;
+    e.worlds.resize(numEnvs);
+    e.nextSeeds.assign(numEnvs, 0);
+    e.delivered.assign(numEnvs, 0);
+}
+
+// writeNearest: Os k pontos de (xs, zs) mais próximos de (x, z), do mais perto ao mais longe,
+// como trios (dx, dz, valor); sem values o valor é 1. As vagas que sobram ficam zeradas.
+void writeNearest(const float* xs, const float* zs, const float* values, int count, float x, float z, int k,
+                  float* out) {
+    float bestDist[ENV_NEAR_MAX];
+    int best[ENV_NEAR_MAX];
+    int found = 0;
+    for (int i = 0; i < count; ++i) { // Inserção ordenada: k é pequeno e os pools também
+        float dx = xs[i] - x, dz = zs[i] - z;
+        float d = dx * dx + dz * dz;
+        if (found == k && d >= bestDist[k - 1]) continue;
+        int j = found < k ? found++ : k - 1;
+        for (; j > 0 && bestDist[j - 1] > d; --j) {
+            bestDist[j] = bestDist[j - 1];
+            best[j] = best[j - 1];
+        }
+        bestDist[j] = d;
+        best[j] = i;
+    }
+    for (int j = 0; j < k; ++j) {
+        if (j < found) {
+            out[3 * j] = xs[best[j]] - x;
+            out[3 * j + 1] = zs[best[j]] - z;
+            out[3 * j + 2] = values ? values[best[j]] : 1.0f;
+        } else {
+            out[3 * j] = out[3 * j + 1] = out[3 * j + 2] = 0.0f;
+        }
+    }
+}
+
+// writeObservation: Escreve os OBS_SIZE floats que descrevem a partida (layout em EnvObservation).
+void writeObservation(const GameWorld& w, float* obs) {
+    const Penguin& mother = w.motherPenguin;
+    float radians = mother.rotation * M_PI / 180.0f;
+    obs[OBS_MOTHER_X] = mother.pos.x;
+    obs[OBS_MOTHER_Z] = mother.pos.z;
+    obs[OBS_FORWARD_X] = sin(radians);
+    obs[OBS_FORWARD_Z] = cos(radians);
+    obs[OBS_HAS_FISH] = mother.hasFish ? 1.0f : 0.0f;
+    obs[OBS_BABY_DX] = w.babyPenguin.pos.x - mother.pos.x;
+    obs[OBS_BABY_DZ] = w.babyPenguin.pos.z - mother.pos.z;
+    obs[OBS_ENERGY] = std::max(0.0f, w.babyEnergyTime) / w.params.babyEnergyMax;
+    obs[OBS_TIME] = w.gameTime / w.params.gameDuration;
+    writeNearest(w.fishes.column(FISH_X), w.fishes.column(FISH_Z), NULL, w.fishes.count,
+                 mother.pos.x, mother.pos.z, ENV_NEAR_FISH, obs + OBS_FISH);
+    writeNearest(w.holes.column(HOLE_X), w.holes.column(HOLE_Z), w.holes.column(HOLE_RADIUS), w.holes.count,
+                 mother.pos.x, mother.pos.z, ENV_NEAR_HOLES, obs + OBS_HOLES);
+}
+
+// resetEnvJob: Recomeça um pedaço de partidas com as sementes da chamada de reset.
+void resetEnvJob(void* context, int job, int worker) {
+    VecEnv& e = *(VecEnv*)context;
+    int last = std::min((job + 1) * ENV_CHUNK, e.numEnvs);
+    for (int i = job * ENV_CHUNK; i < last; ++i) {
+        GameWorld& w = e.worlds[i];
+        w.params = e.params;
+        resetWorld(w, e.seed + i);
+        e.nextSeeds[i] = e.seed + i + e.numEnvs;
+        e.delivered[i] = 0;
+        writeObservation(w, e.observations + (size_t)i * OBS_SIZE);
+    }
+}
+
+// stepEnvJob: Avança um pedaço de partidas um passo, como o timer() avança a da janela.
+void stepEnvJob(void* context, int job, int worker) {
+    VecEnv& e = *(VecEnv*)context;
+    int last = std::min((job + 1) * ENV_CHUNK, e.numEnvs);
+    for (int i = job * ENV_CHUNK; i < last; ++i) {
+        GameWorld& w = e.worlds[i];
+        applyControls(w, e.actions[i], SIM_DELTA_TIME);
+        simulateStep(w, SIM_DELTA_TIME);
+        float reward = (w.fishDelivered - e.delivered[i]) * ENV_REWARD_DELIVERY;
+        e.delivered[i] = w.fishDelivered;
+        bool done = w.gameState != 0;
+        if (done) {
+            reward += w.gameState == 1 ? ENV_REWARD_WIN : ENV_REWARD_LOSS;
+            w.params = e.params;
+            resetWorld(w, e.nextSeeds[i]);
+            e.nextSeeds[i] += e.numEnvs;
+            e.delivered[i] = 0;
+        }
+        e.rewards[i] = reward;
+        e.dones[i] = done;
+        writeObservation(w, e.observations + (size_t)i * OBS_SIZE);
+    }
+}
+
+// runEnvJobs: Roda a tarefa sobre todos os pedaços; sem sistema de tarefas, na própria thread.
+void runEnvJobs(VecEnv& e, JobFunction function) {
+    int numJobs = (e.numEnvs + ENV_CHUNK - 1) / ENV_CHUNK;
+    if (jobSystem.queues) parallelFor(numJobs, function, &e);
+    else for (int j = 0; j < numJobs; ++j) function(&e, j, 0);
+}
+
+// resetVecEnv: Recomeça todas as partidas (a i com seed + i) e escreve as observações iniciais.
+void resetVecEnv(VecEnv& e, unsigned long long seed, float* observations) {
+    e.seed = seed;
+    e.observations = observations;
+    runEnvJobs(e, resetEnvJob);
+}
+
+// stepVecEnv: Aplica actions[i] à partida i por um passo de SIM_DELTA_TIME e escreve
+// observations[i * OBS_SIZE ...], rewards[i] e dones[i].
+void stepVecEnv(VecEnv& e, const int* actions, float* observations, float* rewards, unsigned char* dones) {
+    e.actions = actions;
+    e.observations = observations;
+    e.rewards = rewards;
+    e.dones = dones;
+    runEnvJobs(e, stepEnvJob);
+}
+
+// runEnvBenchmark: Passos por segundo do ambiente com ações sorteadas (trocadas a cada
+// ENV_BENCH_HOLD passos, como teclas seguradas) e um checksum das observações finais.
+int runEnvBenchmark(int numEnvs, int numSteps) {
+    const int ENV_BENCH_HOLD = 8;
+    VecEnv* env = new VecEnv();
+    initVecEnv(*env, numEnvs, world.params);
+    std::vector<float> observations((size_t)numEnvs * OBS_SIZE);
+    std::vector<float> rewards(numEnvs);
+    std::vector<unsigned char> dones(numEnvs);
+    std::vector<int> actions(numEnvs);
+    GameRng rng;
+    seedRng(rng, world.seed);
+    resetVecEnv(*env, world.seed, observations.data());
+
+    long long episodes = 0;
+    double totalReward = 0.0;
+    double actionSeconds = 0.0;
+    double start = nowSeconds();
+    for (int step = 0; step < numSteps; ++step) {
+        if (step % ENV_BENCH_HOLD == 0) {
+            double actionStart = nowSeconds();
+            for (int i = 0; i < numEnvs; ++i) actions[i] = (int)(randomFloat(rng) * 16.0f);
+            actionSeconds += nowSeconds() - actionStart;
+        }
+        stepVecEnv(*env, actions.data(), observations.data(), rewards.data(), dones.data());
+        for (int i = 0; i < numEnvs; ++i) {
+            totalReward += rewards[i];
+            episodes += dones[i];
+        }
+    }
+    double wallSeconds = nowSeconds() - start - actionSeconds;
+
+    unsigned long long checksum = hashBytes(0xCBF29CE484222325ULL, observations.data(),
+                                            observations.size() * sizeof(float));
+    checksum = hashBytes(checksum, &episodes, sizeof(episodes));
+    long long envSteps = (long long)numEnvs * numSteps;
+    printf("Ambiente: %d partidas x %d passos | observacao de %d floats\n", numEnvs, numSteps, (int)OBS_SIZE);
+    printf("Episodios terminados: %lld | Recompensa media por episodio: %.3f\n", episodes,
+           episodes > 0 ? totalReward / episodes : 0.0);
+    printf("Tempo real: %.3f s | Threads: %d | Passos de ambiente/s: %.0f\n", wallSeconds,
+           jobSystem.numWorkers, wallSeconds > 0.0 ? envSteps / wallSeconds : 0.0);
+    printf("Semente: %llu | Checksum: %016llx\n", world.seed, checksum);
+    delete env;
+    return 0;
+}
+
+// --- API C ---
+// Ações em int (máscara de ControlKey), observações em float (num_envs x OBS_SIZE),
+// recompensas em float e fins de partida em unsigned char, todos com num_envs entradas.
+#ifdef PENGUIN_ENV_LIBRARY
+#define PENGUIN_ENV_API extern "C" __attribute__((visibility("default")))
+#else
+#define PENGUIN_ENV_API extern "C"
+#endif
+
+// penguin_env_create: Cria num_envs partidas; num_threads 0 usa todos os núcleos e só vale
+// para o primeiro ambiente vivo, que inicia o sistema de tarefas. NULL se num_envs < 1.
+PENGUIN_ENV_API VecEnv* penguin_env_create(int num_envs, int num_threads) {
+    if (num_envs < 1) return NULL;
+    std::lock_guard<std::mutex> lock(envApiMutex);
+    static bool kernelsReady = false;
+    if (!kernelsReady) {
+        initKernels(NULL);
+        kernelsReady = true;
+    }
+    VecEnv* env = new VecEnv();
+    initVecEnv(*env, num_envs, DEFAULT_GAME_PARAMS);
+    if (envApiCount++ == 0 && !jobSystem.queues) {
+        startJobSystem(num_threads);
+        envApiStartedJobs = true;
+    }
+    return env;
+}
+
+// penguin_env_destroy: Libera as partidas; o último ambiente vivo para o sistema de tarefas,
+// se foi a API que o iniciou.
+PENGUIN_ENV_API void penguin_env_destroy(VecEnv* env) {
+    if (!env) return;
+    std::lock_guard<std::mutex> lock(envApiMutex);
+    delete env;
+    if (--envApiCount == 0 && envApiStartedJobs) {
+        stopJobSystem();
+        envApiStartedJobs = false;
+    }
+}
+
+// penguin_env_observation_size: Floats por partida no buffer de observações.
+PENGUIN_ENV_API int penguin_env_observation_size() {
+    return OBS_SIZE;
+}
+
+// penguin_env_num_envs: Partidas do ambiente.
+PENGUIN_ENV_API int penguin_env_num_envs(const VecEnv* env) {
+    return env->numEnvs;
+}
+
+// penguin_env_set_param: Muda um parâmetro de jogo pelo nome usado em --sweep; vale a partir
+// do próximo reset ou recomeço. Retorna 0 se o nome não existir.
+PENGUIN_ENV_API int penguin_env_set_param(VecEnv* env, const char* name, double value) {
+    const SweepParam* param = findSweepParam(name);
+    if (!param) return 0;
+    setSweepParam(env->params, param, value);
+    return 1;
+}
+
+// penguin_env_reset: Recomeça todas as partidas (a i com seed + i).
+PENGUIN_ENV_API void penguin_env_reset(VecEnv* env, unsigned long long seed, float* observations) {
+    resetVecEnv(*env, seed, observations);
+}
+
+// penguin_env_step: Avança todas as partidas um passo de simulação.
+PENGUIN_ENV_API void penguin_env_step(VecEnv* env, const int* actions, float* observations, float* rewards,
+                                      unsigned char* dones) {
+    stepVecEnv(*env, actions, observations, rewards, dones);
+}
+
+// ===================================================================
+// PILOTO AUTOMÁTICO (--autopilot, tecla 'a', --bench-planner)
+//
+// O piloto planeja com A* sobre uma grade de ocupação em que cada buraco
+// é inflado pelo raio do pinguim, então qualquer caminho pela grade é
+// seguro para o centro do pinguim. A grade é atualizada por buraco, só nas
+// células do seu disco, e o caminho só é refeito quando o objetivo muda de
+// célula ou a grade muda. A saída é a mesma máscara de teclas de controle
+// que special()/specialUp() produzem, aplicada por applyControls.
+// ===================================================================
+
+// planPath: A* com 8 vizinhos da célula start até goal, sem cortar quinas de células
+// bloqueadas. Se um buraco surgiu em volta do pinguim e start está bloqueada, células
+// bloqueadas passam a custar AUTOPILOT_ESCAPE_COST, e o caminho sai pela borda mais
+// próxima. Devolve em path as células do passo seguinte até o objetivo.
+bool planPath(const OccupancyGrid& grid, PathPlanner& planner, int start, int goal, std::vector<int>& path) {
+    static const int NEIGHBOR_X[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int NEIGHBOR_Z[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+    const float DIAGONAL = 1.41421356f;
+    int numCells = grid.cellsX * grid.cellsZ;
+    if ((int)planner.cost.size() < numCells) {
+        planner.cost.resize(numCells);
+        planner.parent.resize(numCells);
+        planner.opened.assign(numCells, 0);
+        planner.closed.assign(numCells, 0);
+        planner.search = 0;
+    }
+    if (++planner.search == 0) { // As marcas deram a volta: limpa de verdade uma vez
+        std::fill(planner.opened.begin(), planner.opened.end(), 0);
+        std::fill(planner.closed.begin(), planner.closed.end(), 0);
+        planner.search = 1;
+    }
+    unsigned int search = planner.search;
+    planner.expanded = 0;
+    planner.open.clear();
+    path.clear();
+    if (grid.blocked(goal)) return false;
+    bool escaping = grid.blocked(start);
+
+    int goalX = goal % grid.cellsX, goalZ = goal / grid.cellsX;
+    planner.cost[start] = 0.0f;
+    planner.parent[start] = -1;
+    planner.opened[start] = search;
+    PathNode first = {0.0f, start};
+    planner.open.push_back(first);
+    while (!planner.open.empty()) {
+        std::pop_heap(planner.open.begin(), planner.open.end());
+        int cell = planner.open.back().cell;
+        planner.open.pop_back();
+        if (planner.closed[cell] == search) continue; // Entrada velha de uma célula já melhorada
+        planner.closed[cell] = search;
+        planner.expanded++;
+        if (cell == goal) {
+            for (int c = goal; c != start; c = planner.parent[c]) path.push_back(c);
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+
+        int cx = cell % grid.cellsX, cz = cell / grid.cellsX;
+        for (int d = 0; d < 8; ++d) {
+            int nx = cx + NEIGHBOR_X[d], nz = cz + NEIGHBOR_Z[d];
+            if (nx < 0 || nz < 0 || nx >= grid.cellsX || nz >= grid.cellsZ) continue;
+            int next = nz * grid.cellsX + nx;
+            if (planner.closed[next] == search) continue;
+            bool diagonal = d >= 4;
+            float cost = planner.cost[cell] + (diagonal ? DIAGONAL : 1.0f);
+            if (escaping) {
+                if (grid.blocked(next)) cost += AUTOPILOT_ESCAPE_COST;
+            } else {
+                if (grid.blocked(next)) continue;
+                if (diagonal && (grid.blocked(cz * grid.cellsX + nx) || grid.blocked(nz * grid.cellsX + cx))) continue;
+            }
+            if (planner.opened[next] == search && cost >= planner.cost[next]) continue;
+            planner.opened[next] = search;
+            planner.cost[next] = cost;
+            planner.parent[next] = cell;
+            // Distância octil, levemente aumentada para desempatar a favor de quem está mais perto do objetivo
+            int hx = abs(nx - goalX), hz = abs(nz - goalZ);
+            float h = (std::max(hx, hz) + (DIAGONAL - 1.0f) * std::min(hx, hz)) * 1.001f;
+            PathNode node = {cost + h, next};
+            planner.open.push_back(node);
+            std::push_heap(planner.open.begin(), planner.open.end());
+        }
+    }
+    return false;
+}
+
+// lineClear: Verifica, em passos de meia célula, se o segmento só atravessa células livres.
+bool lineClear(const OccupancyGrid& grid, float x0, float z0, float x1, float z1) {
+    float dx = x1 - x0, dz = z1 - z0;
+    int steps = (int)(sqrt(dx * dx + dz * dz) / (grid.cellSize * 0.5f)) + 1;
+    for (int i = 1; i <= steps; ++i) {
+        float t = (float)i / steps;
+        if (grid.blocked(grid.cellOf(x0 + dx * t, z0 + dz * t))) return false;
+    }
+    return true;
+}
+
+// nearestFreeCell: Célula livre mais próxima de (x, z) a no máximo radius dela, ou -1.
+int nearestFreeCell(const OccupancyGrid& grid, float x, float z, float radius) {
+    int cell = grid.cellOf(x, z);
+    if (!grid.blocked(cell)) return cell;
+    int x0 = std::max((int)((x - radius - grid.originX) / grid.cellSize), 0);
+    int x1 = std::min((int)((x + radius - grid.originX) / grid.cellSize), grid.cellsX - 1);
+    int z0 = std::max((int)((z - radius - grid.originZ) / grid.cellSize), 0);
+    int z1 = std::min((int)((z + radius - grid.originZ) / grid.cellSize), grid.cellsZ - 1);
+    int best = -1;
+    float bestDistance = radius * radius;
+    for (int cz = z0; cz <= z1; ++cz) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            int c = cz * grid.cellsX + cx;
+            float dx = grid.centerX(c) - x, dz = grid.centerZ(c) - z;
+            if (!grid.blocked(c) && dx * dx + dz * dz <= bestDistance) {
+                bestDistance = dx * dx + dz * dz;
+                best = c;
+            }
+        }
+    }
+    return best;
+}
+
+// resetAutopilot: Prepara o piloto para uma partida nova do mundo w.
+void resetAutopilot(AutopilotAgent& a, const GameWorld& w) {
+    a.grid.reset(w.params.icePlatformSize, AUTOPILOT_CELL_SIZE);
+    a.stampX.assign(w.holes.slotToDense.size(), 0.0f);
+    a.stampZ.assign(w.holes.slotToDense.size(), 0.0f);
+    a.stampRadius.assign(w.holes.slotToDense.size(), 0.0f);
+    a.path.clear();
+    a.path.reserve(a.grid.cellsX * a.grid.cellsZ);          // Um caminho não repete célula
+    a.planner.open.reserve(a.grid.cellsX * a.grid.cellsZ);
+    a.cursor = 0;
+    a.aim = -1;
+    a.goalCell = -1;
+    a.pathVersion = -1;
+    a.unreachable.clear();
+    a.plans = 0;
+}
+
+// syncAutopilotGrid: Carimba os buracos novos na grade e apaga os que sumiram ou mudaram.
+void syncAutopilotGrid(AutopilotAgent& a, const GameWorld& w) {
+    const HolePool& holes = w.holes;
+    for (int slot = 0; slot < (int)a.stampRadius.size(); ++slot) {
+        int i = holes.slotToDense[slot];
+        float x = 0.0f, z = 0.0f, radius = 0.0f;
+        if (i >= 0) {
+            x = holes.columns[HOLE_X][i];
+            z = holes.columns[HOLE_Z][i];
+            radius = holes.columns[HOLE_RADIUS][i] + AUTOPILOT_CLEARANCE;
+        }
+        if (radius == a.stampRadius[slot] && x == a.stampX[slot] && z == a.stampZ[slot]) continue;
+        if (a.stampRadius[slot] > 0.0f) a.grid.stamp(a.stampX[slot], a.stampZ[slot], a.stampRadius[slot], -1);
+        if (radius > 0.0f) a.grid.stamp(x, z, radius, 1);
+        a.stampX[slot] = x;
+        a.stampZ[slot] = z;
+        a.stampRadius[slot] = radius;
+    }
+}
+
+// autopilotControls: Decide as teclas de controle do pinguim mãe neste passo: buscar o peixe
+// alcançável mais próximo ou, com um peixe no bico, voltar ao bebê.
+int autopilotControls(AutopilotAgent& a, const GameWorld& w, float deltaTime) {
+    if (w.gameState != 0) return 0;
+    syncAutopilotGrid(a, w);
+    const Penguin& mother = w.motherPenguin;
+    const OccupancyGrid& grid = a.grid;
+
+    // Sem peixe no bico e sem peixe alcançável, espera junto ao bebê
+    float targetX = w.babyPenguin.pos.x, targetZ = w.babyPenguin.pos.z;
+    int goal = grid.cellOf(targetX, targetZ);
+    if (!mother.hasFish) {
+        float best = 1e30f;
+        for (int i = 0; i < w.fishes.count; ++i) {
+            float fx = w.fishes.columns[FISH_X][i], fz = w.fishes.columns[FISH_Z][i];
+            float dx = fx - mother.pos.x, dz = fz - mother.pos.z;
+            if (dx * dx + dz * dz >= best) continue;
+            // Peixe colado a um buraco: basta chegar a uma célula livre ao alcance dele
+            int cell = nearestFreeCell(grid, fx, fz, AUTOPILOT_PICKUP_REACH);
+            if (cell < 0 || std::find(a.unreachable.begin(), a.unreachable.end(), cell) != a.unreachable.end()) continue;
+            best = dx * dx + dz * dz;
+            goal = cell;
+            targetX = grid.blocked(grid.cellOf(fx, fz)) ? grid.centerX(cell) : fx;
+            targetZ = grid.blocked(grid.cellOf(fx, fz)) ? grid.centerZ(cell) : fz;
+        }
+    }
+
+    // Refaz o caminho se o objetivo mudou de célula, a grade mudou ou o pinguim saiu do caminho
+    bool offPath = false;
+    if (a.cursor < (int)a.path.size()) {
+        float dx = grid.centerX(a.path[a.cursor]) - mother.pos.x;
+        float dz = grid.centerZ(a.path[a.cursor]) - mother.pos.z;
+        offPath = dx * dx + dz * dz > 9.0f * grid.cellSize * grid.cellSize;
+    }
+    if (a.pathVersion != grid.version) a.unreachable.clear();
+    if (goal != a.goalCell || a.pathVersion != grid.version || offPath) {
+        a.goalCell = goal;
+        a.pathVersion = grid.version;
+        a.cursor = 0;
+        a.aim = -1;
+        a.plans++;
+        if (!planPath(grid, a.planner, grid.cellOf(mother.pos.x, mother.pos.z), goal, a.path)) {
+            a.unreachable.push_back(goal); // Tenta outro peixe no próximo passo
+            a.cursor = -1;
+        }
+    }
+    if (a.cursor < 0) return 0;
+
+    // Pula as células já alcançadas (a mira pode cortar caminho por várias) e mira na mais
+    // distante à vista entre as próximas. A mira só é escolhida de novo quando o cursor
+    // avança ou ela sai da vista.
+    int cursor = a.cursor;
+    int last = (int)a.path.size() - 1;
+    for (int k = std::min(a.cursor + AUTOPILOT_LOOKAHEAD, last); k >= a.cursor; --k) {
+        float dx = grid.centerX(a.path[k]) - mother.pos.x;
+        float dz = grid.centerZ(a.path[k]) - mother.pos.z;
+        if (dx * dx + dz * dz <= grid.cellSize * grid.cellSize) {
+            a.cursor = k + 1;
+            break;
+        }
+    }
+    float aimX = targetX, aimZ = targetZ;
+    if (a.cursor <= last) {
+        if (a.aim < a.cursor || a.cursor != cursor
+            || !lineClear(grid, mother.pos.x, mother.pos.z, grid.centerX(a.path[a.aim]), grid.centerZ(a.path[a.aim]))) {
+            a.aim = std::min(a.cursor + AUTOPILOT_LOOKAHEAD, last);
+            while (a.aim > a.cursor && !lineClear(grid, mother.pos.x, mother.pos.z,
+                                                  grid.centerX(a.path[a.aim]), grid.centerZ(a.path[a.aim]))) a.aim--;
+        }
+        if (a.aim < last) { // A última célula contém o próprio alvo, que é mirado direto
+            aimX = grid.centerX(a.path[a.aim]);
+            aimZ = grid.centerZ(a.path[a.aim]);
+        }
+    }
+    return steerControls(mother, aimX, aimZ, w.params, deltaTime);
+}
+
+// steerControls: Teclas de controle que levam o pinguim até (targetX, targetZ): gira na
+// direção do alvo e anda quando está de frente para ele.
+int steerControls(const Penguin& penguin, float targetX, float targetZ, const GameParams& params, float deltaTime) {
+    float dx = targetX - penguin.pos.x, dz = targetZ - penguin.pos.z;
+    if (dx * dx + dz * dz < 0.01f) return 0; // Chegou
+    // Andar para frente soma (sin, cos) da rotação à posição; girar à esquerda aumenta a rotação
+    float error = atan2(dx, dz) * 180.0f / M_PI - penguin.rotation;
+    error = fmod(error, 360.0f);
+    if (error > 180.0f) error -= 360.0f;
+    if (error < -180.0f) error += 360.0f;
+    float turnStep = params.rotationSpeed * deltaTime;
+    int keys = 0;
+    if (error > turnStep * 0.5f) keys |= CONTROL_TURN_LEFT;
+    else if (error < -turnStep * 0.5f) keys |= CONTROL_TURN_RIGHT;
+    // Andando e girando o pinguim descreve um círculo; um alvo dentro dele nunca seria
+    // alcançado, então nesse caso gira parado
+    float turnRadius = params.penguinSpeed / (params.rotationSpeed * M_PI / 180.0f);
+    float distance = sqrt(dx * dx + dz * dz);
+    if (fabs(error) < AUTOPILOT_AIM_DEGREES && distance >= 2.0f * turnRadius * sin(fabs(error) * M_PI / 180.0f)) {
+        keys |= CONTROL_FORWARD;
+    }
+    return keys;
+}
+
+// runPlannerJob: Faz um pedaço dos planejamentos do benchmark com os buffers do trabalhador.
+void runPlannerJob(void* context, int job, int worker) {
+    PlannerBenchmark& bench = *(PlannerBenchmark*)context;
+    PathPlanner& planner = bench.planners[worker];
+    std::vector<int>& path = bench.paths[worker];
+    PlannerStats& stats = bench.stats[worker];
+    int first = job * bench.plansPerJob;
+    int last = std::min(first + bench.plansPerJob, (int)bench.starts.size());
+    for (int i = first; i < last; ++i) {
+        bool found = planPath(bench.grid, planner, bench.starts[i], bench.goals[i], path);
+        stats.plans++;
+        stats.expanded += planner.expanded;
+        if (found) {
+            stats.found++;
+            stats.length += path.size();
+        }
+        stats.checksum ^= (path.size() + 1) * 0x9E3779B97F4A7C15ULL + i;
+    }
+}
+
+// runPlannerBenchmark: Mede planejamentos por segundo numa grade de gridSize x gridSize células
+// com buracos inflados espalhados ao acaso, entre pares de células livres sorteados.
+int runPlannerBenchmark(int gridSize, int numPlans) {
+    PlannerBenchmark bench;
+    OccupancyGrid& grid = bench.grid;
+    grid.reset(gridSize * AUTOPILOT_CELL_SIZE, AUTOPILOT_CELL_SIZE);
+    GameRng rng;
+    seedRng(rng, world.seed);
+
+    // Buracos suficientes para cobrir uns 15% da grade
+    float radius = 0.4f + AUTOPILOT_CLEARANCE;
+    float extent = gridSize * AUTOPILOT_CELL_SIZE;
+    int numHoles = (int)(extent * extent * 0.15f / (M_PI * radius * radius));
+    for (int i = 0; i < numHoles; ++i) {
+        grid.stamp(grid.originX + randomFloat(rng) * extent, grid.originZ + randomFloat(rng) * extent, radius, 1);
+    }
+    int numCells = grid.cellsX * grid.cellsZ;
+    int blockedCells = 0;
+    for (int c = 0; c < numCells; ++c) blockedCells += grid.blocked(c);
+    if (blockedCells == numCells) {
+        fprintf(stderr, "--bench-planner: grade toda bloqueada\n");
+        return 1;
+    }
+    for (int i = 0; i < numPlans; ++i) {
+        int start, goal;
+        do { start = std::min((int)(randomFloat(rng) * numCells), numCells - 1); } while (grid.blocked(start));
+        do { goal = std::min((int)(randomFloat(rng) * numCells), numCells - 1); } while (grid.blocked(goal));
+        bench.starts.push_back(start);
+        bench.goals.push_back(goal);
+    }
+
+    int numWorkers = jobSystem.numWorkers;
+    bench.plansPerJob = 16;
+    bench.planners.resize(numWorkers);
+    bench.paths.resize(numWorkers);
+    bench.stats.assign(numWorkers, PlannerStats());
+    // Um planejamento por trabalhador antes de medir, para alocar os buffers
+    for (int w = 0; w < numWorkers; ++w) planPath(grid, bench.planners[w], bench.starts[0], bench.starts[0], bench.paths[w]);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallelFor((numPlans + bench.plansPerJob - 1) / bench.plansPerJob, runPlannerJob, &bench);
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PlannerStats total = PlannerStats();
+    for (int w = 0; w < numWorkers; ++w) {
+        total.plans += bench.stats[w].plans;
+        total.found += bench.stats[w].found;
+        total.expanded += bench.stats[w].expanded;
+        total.length += bench.stats[w].length;
+        total.checksum ^= bench.stats[w].checksum;
+    }
+    double plansPerSecond = wallSeconds > 0.0 ? total.plans / wallSeconds : 0.0;
+    printf("Grade: %dx%d celulas (%.1f%% bloqueadas, %d buracos) | Planejamentos: %lld | Com caminho: %.1f%%\n",
+           gridSize, gridSize, blockedCells * 100.0 / numCells, numHoles, total.plans,
+           total.plans > 0 ? total.found * 100.0 / total.plans : 0.0);
+    printf("Celulas expandidas por plano: %.0f | Comprimento medio do caminho: %.1f celulas\n",
+           total.plans > 0 ? (double)total.expanded / total.plans : 0.0,
+           total.found > 0 ? (double)total.length / total.found : 0.0);
+    printf("Tempo real: %.3f s | Threads: %d | Planos/s: %.0f | Planos por quadro de 16 ms: %.0f\n",
+           wallSeconds, numWorkers, plansPerSecond, plansPerSecond * SIM_DELTA_TIME);
+    printf("Semente: %llu | Checksum: %016llx\n", world.seed, total.checksum);
+    return 0;
+}
+
+// ===================================================================
+// ARENA COM MUITOS PINGUINS (--arena)
+//
+// Milhares de pares mãe/bebê numa plataforma de centenas de unidades,
+// cada mãe guiada por uma regra simples: buscar o peixe visível mais
+// próximo e levá-lo ao seu bebê. A plataforma é um GameWorld comum, então
+// movimento, colisões, energia e geração seguem as funções da partida;
+// a agenda pede uma geração de cada tipo por par. Cada passo tem uma fase
+// paralela, dividida em pedaços de pares, que só lê peixes e buracos e
+// escreve no estado do próprio par; pedidos de peixe vão para a lista do
+// pedaço. Na fase serial os pedidos são aplicados em ordem de par, então
+// quando duas mães pegam o mesmo peixe vence sempre a de menor índice, com
+// qualquer número de threads.
+// ===================================================================
+
+// resetArena: Espalha numPairs pares numa grade com pequenas variações e esvazia a arena.
+void resetArena(ArenaWorld& a, int numPairs, unsigned long long seed) {
+    GameWorld& f = a.field;
+    float size = sqrt(numPairs * ARENA_AREA_PER_PAIR);
+    f.params = world.params;
+    f.params.icePlatformSize = size;
+    f.params.maxFish = numPairs;
+    f.params.maxHoles = std::min(numPairs, world.params.maxHoles * numPairs / 8);
+    resetWorld(f, seed);
+    f.timers.cancel(f.energyDeadline); // A energia é contada por par
+    f.fishGrid.reset(size, ARENA_CELL_SIZE, f.params.maxFish);
+    f.holeGrid.reset(size, ARENA_CELL_SIZE, f.params.maxHoles);
+    f.extraPenguinGrid.reset(size, ARENA_CELL_SIZE, 2 * numPairs);
+    f.extraPenguins.resize(2 * numPairs); // Mãe em 2i, bebê em 2i + 1
+    // O centro só é especial na partida, onde fica o bebê; aqui cada bebê barra a geração como pinguim
+    f.spawnExclusions.clear();
+    // resetWorld marcou os pedidos de geração do par 0; os dos outros pares ficam
+    // defasados ao longo do intervalo, para não caírem todos no mesmo passo
+    for (int i = 1; i < numPairs; ++i) {
+        if (f.fishSpawnSteps > 0)
+            f.timers.schedule(f.fishSpawnSteps - (long long)i * f.fishSpawnSteps / numPairs, TIMER_FISH_SPAWN, -1);
+        if (f.holeSpawnSteps > 0)
+            f.timers.schedule(f.holeSpawnSteps - (long long)i * f.holeSpawnSteps / numPairs, TIMER_HOLE_SPAWN, -1);
+    }
+    a.aliveCount = numPairs;
+    a.claimConflicts = 0;
+
+    ArenaPairs& p = a.pairs;
+    p.count = numPairs;
+    p.motherX.resize(numPairs); p.motherZ.resize(numPairs);
+    p.rotation.assign(numPairs, 0.0f); p.wingAnimation.assign(numPairs, 0.0f);
+    p.isMoving.assign(numPairs, 0);
+    p.babyX.resize(numPairs); p.babyZ.resize(numPairs);
+    p.energy.assign(numPairs, f.params.babyEnergyMax);
+    p.energyDeadline.assign(numPairs, f.energySteps > 0 ? f.energySteps : -1);
+    p.hasFish.assign(numPairs, 0);
+    p.alive.assign(numPairs, 1);
+    p.fishDelivered.assign(numPairs, 0);
+
+    int side = (int)ceil(sqrt((double)numPairs));
+    float spacing = size / side;
+    for (int i = 0; i < numPairs; ++i) {
+        float x = -size / 2.0f + ((i % side) + 0.25f + randomFloat(f.rng) * 0.5f) * spacing;
+        float z = -size / 2.0f + ((i / side) + 0.25f + randomFloat(f.rng) * 0.5f) * spacing;
+        p.babyX[i] = x;
+        p.babyZ[i] = z;
+        p.motherX[i] = x;
+        p.motherZ[i] = z + 2.0f;
+        f.extraPenguins[2 * i] = {x, PENGUIN_HEIGHT, z + 2.0f};
+        f.extraPenguins[2 * i + 1] = {x, PENGUIN_HEIGHT, z};
+        f.extraPenguinGrid.insert(2 * i, x, z + 2.0f, PENGUIN_RADIUS);
+        f.extraPenguinGrid.insert(2 * i + 1, x, z, PENGUIN_RADIUS);
+    }
+    syncArenaPenguins(a);
+
+    int numChunks = (numPairs + ARENA_CHUNK_SIZE - 1) / ARENA_CHUNK_SIZE;
+    a.chunkClaims.assign(numChunks, std::vector<ArenaClaim>());
+    a.workerQueries.assign(jobSystem.numWorkers, std::vector<int>());
+    a.workerCandidates.assign(jobSystem.numWorkers, CandidateBatch());
+    // Cada par pede no máximo um peixe e uma consulta não passa do pool: o passo não aloca
+    int largestPool = std::max(f.params.maxFish, f.params.maxHoles);
+    for (int c = 0; c < numChunks; ++c) a.chunkClaims[c].reserve(ARENA_CHUNK_SIZE);
+    for (int w = 0; w < jobSystem.numWorkers; ++w) {
+        a.workerQueries[w].reserve(largestPool);
+        CandidateBatch& c = a.workerCandidates[w];
+        c.x.reserve(largestPool); c.y.reserve(largestPool); c.z.reserve(largestPool);
+        c.radius.reserve(largestPool); c.dense.reserve(largestPool); c.hit.reserve(largestPool);
+    }
+}
+
+// syncArenaPenguins: Leva para a plataforma as mães que andaram na fase paralela, para
+// que a geração as evite, e tira dela os pares que saíram do jogo. O par 0 faz o papel
+// dos pinguins da partida.
+void syncArenaPenguins(ArenaWorld& a) {
+    GameWorld& f = a.field;
+    const ArenaPairs& p = a.pairs;
+    for (int i = 0; i < p.count; ++i) {
+        if (!p.alive[i]) {
+            if (f.extraPenguinGrid.cellOf[2 * i] >= 0) {
+                f.extraPenguinGrid.remove(2 * i);
+                f.extraPenguinGrid.remove(2 * i + 1);
+            }
+            continue;
+        }
+        f.extraPenguins[2 * i].x = p.motherX[i];
+        f.extraPenguins[2 * i].z = p.motherZ[i];
+        f.extraPenguinGrid.move(2 * i, p.motherX[i], p.motherZ[i]);
+    }
+    f.motherPenguin = arenaPenguin(a, 0, false);
+    f.babyPenguin = arenaPenguin(a, 0, true);
+    f.penguinGrid.move(PENGUIN_MOTHER_ID, f.motherPenguin.pos.x, f.motherPenguin.pos.z);
+}
+
+// updateArenaPair: Fase paralela de um par: energia, movimento, buracos, entrega e pedido de peixe.
+void updateArenaPair(ArenaWorld& a, int i, float deltaTime, std::vector<int>& query,
+                     CandidateBatch& candidates, std::vector<ArenaClaim>& claims) {
+    const GameWorld& f = a.field;
+    ArenaPairs& p = a.pairs;
+    p.energy[i] -= deltaTime;
+    if (p.energyDeadline[i] >= 0 && f.step >= p.energyDeadline[i]) { p.alive[i] = 0; return; }
+
+    Penguin mother = arenaPenguin(a, i, false);
+    Penguin baby = arenaPenguin(a, i, true);
+    float targetX = baby.pos.x, targetZ = baby.pos.z;
+    if (!mother.hasFish) {
+        // Procura o peixe visível mais próximo; sem nenhum, mira sempre um pouco à
+        // esquerda e vagueia em círculos
+        query.clear();
+        f.fishGrid.query(mother.pos.x, mother.pos.z, ARENA_SIGHT_RADIUS, query);
+        float bestDist = ARENA_SIGHT_RADIUS * ARENA_SIGHT_RADIUS;
+        float radians = (mother.rotation + 15.0f) * M_PI / 180.0f;
+        targetX = mother.pos.x + sin(radians) * ARENA_SIGHT_RADIUS;
+        targetZ = mother.pos.z + cos(radians) * ARENA_SIGHT_RADIUS;
+        for (int k = 0; k < (int)query.size(); ++k) {
+            int fish = f.fishes.slotToDense[query[k]];
+            float dx = f.fishes.columns[FISH_X][fish] - mother.pos.x;
+            float dz = f.fishes.columns[FISH_Z][fish] - mother.pos.z;
+            if (dx * dx + dz * dz >= bestDist) continue;
+            bestDist = dx * dx + dz * dz;
+            targetX = f.fishes.columns[FISH_X][fish];
+            targetZ = f.fishes.columns[FISH_Z][fish];
+        }
+    }
+    controlPenguin(mother, steerControls(mother, targetX, targetZ, f.params, deltaTime), f.params, deltaTime);
+    animatePenguin(mother, deltaTime);
+    p.motherX[i] = mother.pos.x;
+    p.motherZ[i] = mother.pos.z;
+    p.rotation[i] = mother.rotation;
+    p.isMoving[i] = mother.isMoving;
+    p.wingAnimation[i] = mother.wingAnimation;
+
+    if (penguinInHole(f.holes, f.holeGrid, mother.pos, query, candidates)) {
+        p.alive[i] = 0;
+        return;
+    }
+    if (!mother.hasFish) {
+        int fish = fishInReach(f.fishes, f.fishGrid, mother.pos, query, candidates);
+        if (fish >= 0) {
+            ArenaClaim claim = {i, f.fishes.denseToSlot[fish]};
+            claims.push_back(claim);
+        }
+    } else if (deliverFish(mother, baby)) {
+        // Como refillBabyEnergy, com o prazo guardado no próprio par
+        p.hasFish[i] = 0;
+        p.energy[i] = f.params.babyEnergyMax;
+        p.energyDeadline[i] = f.energySteps > 0 ? f.step + f.energySteps : -1;
+        p.fishDelivered[i]++;
+    }
+}
+
+// runArenaChunk: Tarefa da fase paralela: atualiza um pedaço contíguo de pares.
+void runArenaChunk(void* context, int chunk, int worker) {
+    PROFILE_SCOPE(PROFILE_ARENA_UPDATE);
+    ArenaWorld& a = *(ArenaWorld*)context;
+    std::vector<ArenaClaim>& claims = a.chunkClaims[chunk];
+    claims.clear();
+    int first = chunk * ARENA_CHUNK_SIZE;
+    int last = std::min(first + ARENA_CHUNK_SIZE, a.pairs.count);
+    for (int i = first; i < last; ++i) {
+        if (a.pairs.alive[i]) {
+            updateArenaPair(a, i, SIM_DELTA_TIME, a.workerQueries[worker], a.workerCandidates[worker], claims);
+        }
+    }
+}
+
+// resolveArenaClaims: Fase serial: entrega cada peixe pedido ao par de menor índice,
+// atende os pedidos de geração da agenda e conta os pares que restam.
+void resolveArenaClaims(ArenaWorld& a) {
+    PROFILE_SCOPE(PROFILE_ARENA_RESOLVE);
+    GameWorld& f = a.field;
+    // Pedaços e pares dentro de cada pedaço já estão em ordem crescente de índice
+    for (int c = 0; c < (int)a.chunkClaims.size(); ++c) {
+        const std::vector<ArenaClaim>& claims = a.chunkClaims[c];
+        for (int k = 0; k < (int)claims.size(); ++k) {
+            int dense = f.fishes.slotToDense[claims[k].fishSlot];
+            if (dense < 0) { a.claimConflicts++; continue; } // Já levado por outro par
+            despawnFish(f, dense);
+            a.pairs.hasFish[claims[k].pair] = 1;
+        }
+    }
+
+    syncArenaPenguins(a);
+    updateSpawners(f);
+
+    int alive = 0;
+    for (int i = 0; i < a.pairs.count; ++i) alive += a.pairs.alive[i];
+    a.aliveCount = alive;
+}
+
+// arenaChecksum: Hash do estado da arena, igual para qualquer número de threads.
+unsigned long long arenaChecksum(const ArenaWorld& a) {
+    const ArenaPairs& p = a.pairs;
+    size_t n = p.count;
+    unsigned long long h = worldChecksum(a.field);
+    h = hashBytes(h, &p.motherX[0], n * sizeof(float));
+    h = hashBytes(h, &p.motherZ[0], n * sizeof(float));
+    h = hashBytes(h, &p.rotation[0], n * sizeof(float));
+    h = hashBytes(h, &p.wingAnimation[0], n * sizeof(float));
+    h = hashBytes(h, &p.isMoving[0], n);
+    h = hashBytes(h, &p.energy[0], n * sizeof(float));
+    h = hashBytes(h, &p.energyDeadline[0], n * sizeof(long long));
+    h = hashBytes(h, &p.hasFish[0], n);
+    h = hashBytes(h, &p.alive[0], n);
+    h = hashBytes(h, &p.fishDelivered[0], n * sizeof(int));
+    return h;
+}
+
+// stepArena: Um passo completo da arena: relógio e agenda da plataforma, fase paralela
+// e depois a serial.
+void stepArena(ArenaWorld& a) {
+    advanceWorld(a.field, SIM_DELTA_TIME);
+    parallelFor(a.chunkClaims.size(), runArenaChunk, &a);
+    resolveArenaClaims(a);
+}
+
+// arenaPenguin: Monta a estrutura da mãe ou do bebê de um par da arena.
+Penguin arenaPenguin(const ArenaWorld& a, int i, bool baby) {
+    const ArenaPairs& p = a.pairs;
+    Penguin penguin;
+    penguin.pos = {baby ? p.babyX[i] : p.motherX[i], PENGUIN_HEIGHT, baby ? p.babyZ[i] : p.motherZ[i]};
+    penguin.rotation = baby ? 0.0f : p.rotation[i];
+    penguin.hasFish = !baby && p.hasFish[i];
+    penguin.isMoving = !baby && p.isMoving[i];
+    penguin.wingAnimation = baby ? 0.0f : p.wingAnimation[i];
+    penguin.isBaby = baby;
+    return penguin;
+}
+
+// runArena: Simula numSteps passos de uma arena com numPairs pares e imprime o tempo por passo.
+int runArena(int numPairs, int numSteps) {
+    resetArena(arena, numPairs, world.seed);
+    const GameWorld& f = arena.field;
+    int numChunks = arena.chunkClaims.size();
+    double parallelSeconds = 0.0, serialSeconds = 0.0, worstStep = 0.0;
+    int steps = 0;
+    for (; steps < numSteps && arena.aliveCount > 0; ++steps) {
+        double t0 = nowSeconds();
+        advanceWorld(arena.field, SIM_DELTA_TIME);
+        double t1 = nowSeconds();
+        parallelFor(numChunks, runArenaChunk, &arena);
+        double t2 = nowSeconds();
+        resolveArenaClaims(arena);
+        double t3 = nowSeconds();
+        parallelSeconds += t2 - t1;
+        serialSeconds += (t1 - t0) + (t3 - t2);
+        worstStep = std::max(worstStep, t3 - t0);
+        profileEndFrame();
+    }
+
+    long long delivered = 0;
+    for (int i = 0; i < arena.pairs.count; ++i) delivered += arena.pairs.fishDelivered[i];
+    double n = steps > 0 ? steps : 1;
+    printf("Arena: %d pares em %.0fx%.0f | Passos: %d (%.1f s de jogo) | Threads: %d\n", numPairs,
+           f.params.icePlatformSize, f.params.icePlatformSize, steps, f.gameTime, jobSystem.numWorkers);
+    printf("Pares restantes: %d | Peixes entregues: %lld | Disputas por peixe: %lld | Peixes: %d | Buracos: %d\n",
+           arena.aliveCount, delivered, arena.claimConflicts, f.fishes.count, f.holes.count);
+    printf("Passo medio: %.3f ms (paralelo %.3f ms + serial %.3f ms) | Pior passo: %.3f ms\n",
+           (parallelSeconds + serialSeconds) * 1000.0 / n, parallelSeconds * 1000.0 / n,
+           serialSeconds * 1000.0 / n, worstStep * 1000.0);
+    printf("Semente: %llu | Checksum: %016llx\n", world.seed, arenaChecksum(arena));
+    return 0;
+}
+
+// ===================================================================
+// ALEATORIEDADE DETERMINÍSTICA, GRAVAÇÃO E REPLAY
+//
+// Toda entrada passa por uma fila e só é aplicada no início de um passo da
+// simulação, identificada pelo número desse passo. Com a mesma semente e os
+// mesmos eventos nos mesmos passos, a sessão se repete bit a bit, com ou
+// sem janela. O log é binário: cabeçalho com a semente e, por evento, o
+// intervalo de passos em varint, o tipo e a carga.
+// ===================================================================
+
+const char INPUT_LOG_MAGIC[4] = {'P', 'N', 'G', 'R'};
+const unsigned int INPUT_LOG_VERSION = 3;     // 2: eventos INPUT_KEYS; 3: geração com distância mínima
+
+// seedRng: Inicializa o estado com splitmix64 a partir da semente.
+void seedRng(GameRng& rng, unsigned long long seed) {
+    for (int i = 0; i < 4; i += 2) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        unsigned long long z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        rng.s[i] = (unsigned int)z;
+        rng.s[i + 1] = (unsigned int)(z >> 32);
+    }
+}
+
+// nextRandom: Próximo número de 32 bits do xoshiro128**.
+unsigned int nextRandom(GameRng& rng) {
+    unsigned int* s = rng.s;
+    unsigned int x = s[1] * 5;
+    unsigned int result = ((x << 7) | (x >> 25)) * 9;
+    unsigned int t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+}
+
+// randomFloat: Número uniforme em [0, 1) tirado do gerador da partida.
+float randomFloat(GameRng& rng) {
+    return (nextRandom(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// queueInput: Enfileira uma entrada ao vivo para o próximo passo.
+void queueInput(int type, int action, unsigned long long seed) {
+    if (replayPath) return; // Durante o replay só valem os eventos do log
+    InputEvent ev;
+    ev.step = 0;
+    ev.type = type;
+    ev.action = action;
+    ev.seed = seed;
+    ev.timestamp = nowSeconds();
+    std::lock_guard<std::mutex> lock(inputMutex);
+    pendingInputs.push_back(ev);
+    inputArrived.notify_one();
+}
+
+// applyInput: Executa um evento de entrada no estado do jogo.
+void applyInput(const InputEvent& ev) {
+    if (ev.type == INPUT_ACTION) {
+        applyAction(world, ev.action, SIM_DELTA_TIME);
+    } else if (ev.type == INPUT_RESET) {
+        resetGame(ev.seed);
+    } else if (ev.type == INPUT_KEYS) {
+        sessionKeys = ev.action;
+    }
+}
+
+// applyInputsForStep: Aplica as entradas do passo atual, vindas do log ou da fila.
+void applyInputsForStep() {
+    if (replayPath) {
+        while (replayCursor < (int)replayInputs.size() && replayInputs[replayCursor].step <= sessionStep) {
+            applyInput(replayInputs[replayCursor++]);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock(inputMutex);
+    for (int i = 0; i < (int)pendingInputs.size(); ++i) {
+        InputEvent& ev = pendingInputs[i];
+        ev.step = sessionStep;
+        applyInput(ev);
+        if (recordPath) recordedInputs.push_back(ev);
+        if (ev.timestamp > 0.0) latencyWaiting.push_back(ev); // O piloto não entra na medição
+    }
+    pendingInputs.clear();
+}
+
+// advanceSession: Um passo completo da sessão: entradas, teclas seguradas e depois a simulação.
+void advanceSession() {
+    if (autopilotEnabled && !replayPath) {
+        // O piloto entra como mais um evento de teclas, então a gravação o reproduz sem ele
+        int keys = autopilotControls(autopilot, world, SIM_DELTA_TIME);
+        if (keys != sessionKeys) {
+            InputEvent ev;
+            ev.step = sessionStep;
+            ev.type = INPUT_KEYS;
+            ev.action = keys;
+            ev.seed = 0;
+            ev.timestamp = 0.0;
+            std::lock_guard<std::mutex> lock(inputMutex);
+            pendingInputs.push_back(ev);
+        }
+    }
+    applyInputsForStep();
+    if (!legacyInputLog) applyControls(world, sessionKeys, SIM_DELTA_TIME);
+    simulateStep(world, SIM_DELTA_TIME);
+    sessionStep++;
+}
+
+// writeVarint: Grava um inteiro sem sinal em LEB128.
+void writeVarint(FILE* f, unsigned long long v) {
+    do {
+        unsigned char byte = v & 0x7F;
+        v >>= 7;
+        if (v) byte |= 0x80;
+        fputc(byte, f);
+    } while (v);
+}
+
+// readVarint: Lê um inteiro gravado por writeVarint. Retorna false no fim do arquivo.
+bool readVarint(FILE* f, unsigned long long& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) return false;
+        v |= (unsigned long long)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// writeInputLog: Grava as entradas da sessão, terminando com INPUT_END no passo atual.
+void writeInputLog() {
+    if (!recordPath) return;
+    FILE* f = fopen(recordPath, "wb");
+    if (!f) { perror(recordPath); return; }
+    fwrite(INPUT_LOG_MAGIC, 1, 4, f);
+    fwrite(&INPUT_LOG_VERSION, sizeof(INPUT_LOG_VERSION), 1, f);
+    fwrite(&recordSeed, sizeof(recordSeed), 1, f);
+
+    InputEvent end;
+    end.step = sessionStep;
+    end.type = INPUT_END;
+    end.action = 0;
+    end.seed = 0;
+    end.timestamp = 0.0;
+    recordedInputs.push_back(end);
+
+    long long lastStep = 0;
+    for (int i = 0; i < (int)recordedInputs.size(); ++i) {
+        const InputEvent& ev = recordedInputs[i];
+        writeVarint(f, ev.step - lastStep);
+        lastStep = ev.step;
+        fputc(ev.type, f);
+        if (ev.type == INPUT_ACTION || ev.type == INPUT_KEYS) fputc(ev.action, f);
+        else if (ev.type == INPUT_RESET) fwrite(&ev.seed, sizeof(ev.seed), 1, f);
+    }
+    fclose(f);
+    printf("Sessao gravada em %s: %d eventos, %lld passos, checksum %016llx\n",
+           recordPath, (int)recordedInputs.size(), sessionStep, worldChecksum(world));
+}
+
+// readInputLog: Carrega um log gravado e devolve a semente inicial em seed. Um log que
+// não termina em INPUT_END (truncado ou com evento desconhecido) é recusado.
+bool readInputLog(const char* path, unsigned long long& seed) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+    char magic[4];
+    unsigned int version = 0;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, INPUT_LOG_MAGIC, 4) != 0
+        || fread(&version, sizeof(version), 1, f) != 1 || version < 1 || version > INPUT_LOG_VERSION
+        || fread(&seed, sizeof(seed), 1, f) != 1) {
+        fprintf(stderr, "%s: log de entrada invalido\n", path);
+        fclose(f);
+        return false;
+    }
+    legacyInputLog = version == 1;
+    legacySpawner = version < 3;
+    replayInputs.clear();
+    long long step = 0;
+    unsigned long long delta;
+    bool complete = false;
+    while (readVarint(f, delta)) {
+        InputEvent ev;
+        step += delta;
+        ev.step = step;
+        int type = fgetc(f);
+        if (type == EOF || type > INPUT_KEYS) break;
+        ev.type = type;
+        ev.action = 0;
+        ev.seed = 0;
+        ev.timestamp = 0.0;
+        if (ev.type == INPUT_ACTION || ev.type == INPUT_KEYS) {
+            int action = fgetc(f);
+            if (action == EOF) break;
+            ev.action = action;
+        } else if (ev.type == INPUT_RESET && fread(&ev.seed, sizeof(ev.seed), 1, f) != 1) {
+            break;
+        }
+        replayInputs.push_back(ev);
+        if (ev.type == INPUT_END) {
+            complete = true;
+            break;
+        }
+    }
+    fclose(f);
+    if (!complete) {
+        fprintf(stderr, "%s: log de entrada truncado ou corrompido (sem INPUT_END)\n", path);
+        replayInputs.clear();
+        return false;
+    }
+    replayCursor = 0;
+    return true;
+}
+
+// replayEndStep: Passo em que termina a sessão carregada (evento INPUT_END).
+long long replayEndStep() {
+    return replayInputs.empty() ? 0 : replayInputs.back().step;
+}
+
+// hashBytes: Acumula bytes num hash FNV-1a de 64 bits.
+unsigned long long hashBytes(unsigned long long h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// hashPenguin: Acumula os campos de um pinguim, um a um (a struct tem preenchimento).
+unsigned long long hashPenguin(unsigned long long h, const Penguin& p) {
+    h = hashBytes(h, &p.pos, sizeof(Position));
+    h = hashBytes(h, &p.rotation, sizeof(float));
+    h = hashBytes(h, &p.hasFish, sizeof(bool));
+    h = hashBytes(h, &p.isMoving, sizeof(bool));
+    h = hashBytes(h, &p.wingAnimation, sizeof(float));
+    return h;
+}
+
+// worldChecksum: Hash de todo o estado da simulação, para comparar execuções: relógio,
+// pinguins, gerador, pools e os eventos pendentes da agenda (passo, tipo e alvo).
+unsigned long long worldChecksum(const GameWorld& w) {
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    h = hashBytes(h, &w.gameState, sizeof(w.gameState));
+    h = hashBytes(h, &w.gameTime, sizeof(w.gameTime));
+    h = hashBytes(h, &w.babyEnergyTime, sizeof(w.babyEnergyTime));
+    h = hashBytes(h, &w.step, sizeof(w.step));
+    h = hashBytes(h, &w.fishDelivered, sizeof(w.fishDelivered));
+    h = hashBytes(h, &w.fishSpawnDue, sizeof(w.fishSpawnDue));
+    h = hashBytes(h, &w.holeSpawnDue, sizeof(w.holeSpawnDue));
+    h = hashPenguin(h, w.motherPenguin);
+    h = hashPenguin(h, w.babyPenguin);
+    h = hashBytes(h, w.rng.s, sizeof(w.rng.s));
+    for (int e = 0; e < (int)w.timers.events.size(); ++e) {
+        const TimerEvent& ev = w.timers.events[e];
+        if (ev.bucket < 0) continue; // Livre
+        h = hashBytes(h, &ev.due, sizeof(ev.due));
+        h = hashBytes(h, &ev.kind, sizeof(ev.kind));
+        h = hashBytes(h, &ev.target, sizeof(ev.target));
+    }
+    h = hashBytes(h, &w.fishes.count, sizeof(int));
+    for (int c = 0; c < FISH_NUM_COLUMNS; ++c) h = hashBytes(h, w.fishes.column(c), w.fishes.count * sizeof(float));
+    h = hashBytes(h, &w.holes.count, sizeof(int));
+    for (int c = 0; c < HOLE_NUM_COLUMNS; ++c) h = hashBytes(h, w.holes.column(c), w.holes.count * sizeof(float));
+    return h;
+}
+
+// runReplayHeadless: Reproduz um log sem janela e imprime o checksum final.
+int runReplayHeadless() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long endStep = replayEndStep();
+    while (sessionStep < endStep) {
+        advanceSession();
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Replay de %s: %lld passos em %.3f s | checksum %016llx\n",
+           replayPath, sessionStep, wallSeconds, worldChecksum(world));
+    return 0;
+}
+
+// ===================================================================
+// RENDERIZAÇÃO FORA DA TELA E CAPTURA DE QUADROS
+//
+// Com --offscreen o jogo não abre janela: um contexto EGL sem superfície
+// (Mesa llvmpipe serve) desenha num framebuffer object. A leitura dos pixels
+// usa dois pixel buffers alternados, para que o quadro N seja copiado
+// enquanto o N+1 é desenhado. Os quadros lidos vão por uma fila limitada
+// para uma thread que grava a sequência em PPM ou PNG sem travar o desenho.
+// ===================================================================
+
+// createOffscreenContext: Cria o contexto EGL sem superfície e o framebuffer de destino.
+bool createOffscreenContext(int width, int height) {
+#if defined(PENGUIN_HAS_EGL)
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = getPlatformDisplay
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+        : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        fprintf(stderr, "Nao foi possivel inicializar o EGL\n");
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+    EGLContext context = eglCreateContext(display, numConfigs ? config : (EGLConfig)0, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Nao foi possivel criar o contexto EGL sem superficie\n");
+        return false;
+    }
+
+    GLuint framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Framebuffer fora da tela incompleto\n");
+        return false;
+    }
+    printf("Renderizando fora da tela com %s\n", (const char*)glGetString(GL_RENDERER));
+    return true;
+#else
+    fprintf(stderr, "--offscreen requer EGL, indisponivel nesta plataforma\n");
+    return false;
+#endif
+}
+
+// crc32Update: CRC-32 usado nos blocos do PNG.
+unsigned int crc32Update(unsigned int crc, const unsigned char* data, size_t size) {
+    static unsigned int table[256];
+    if (table[1] == 0) {
+        for (unsigned int n = 0; n < 256; ++n) {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// writeBigEndian32: Grava um inteiro de 32 bits em big-endian.
+void writeBigEndian32(FILE* f, unsigned int v) {
+    unsigned char b[4] = {(unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v};
+    fwrite(b, 1, 4, f);
+}
+
+// writePngChunk: Grava um bloco do PNG com tamanho, tipo, dados e CRC.
+void writePngChunk(FILE* f, const char* type, const unsigned char* data, size_t size) {
+    writeBigEndian32(f, size);
+    fwrite(type, 1, 4, f);
+    if (size) fwrite(data, 1, size, f);
+    unsigned int crc = crc32Update(0, (const unsigned char*)type, 4);
+    writeBigEndian32(f, crc32Update(crc, data, size));
+}
+
+// encodeFrame: Grava um quadro RGBA (origem embaixo, como o OpenGL) em PPM ou PNG.
+// O PNG usa blocos deflate sem compressão, para não depender de zlib.
+void encodeFrame(const CapturedFrame& frame, const char* path, bool png, std::vector<unsigned char>& scratch) {
+    FILE* f = fopen(path, "wb");
+    if (!f) { perror(path); return; }
+    int w = frame.width, h = frame.height;
+
+    // Linhas RGB de cima para baixo, cada uma precedida pelo filtro 0 no PNG
+    int rowSize = w * 3 + (png ? 1 : 0);
+    scratch.resize((size_t)rowSize * h);
+    for (int y = 0; y < h; ++y) {
+        const unsigned char* src = &frame.pixels[(size_t)(h - 1 - y) * w * 4];
+        unsigned char* dst = &scratch[(size_t)y * rowSize];
+        if (png) *dst++ = 0;
+        for (int x = 0; x < w; ++x) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    if (!png) {
+        fprintf(f, "P6\n%d %d\n255\n", w, h);
+        fwrite(&scratch[0], 1, scratch.size(), f);
+        fclose(f);
+        return;
+    }
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, 8, f);
+    unsigned char ihdr[13] = {
+        (unsigned char)(w >> 24), (unsigned char)(w >> 16), (unsigned char)(w >> 8), (unsigned char)w,
+        (unsigned char)(h >> 24), (unsigned char)(h >> 16), (unsigned char)(h >> 8), (unsigned char)h,
+        8, 2, 0, 0, 0 // 8 bits, RGB, deflate, filtro padrão, sem entrelaçamento
+    };
+    writePngChunk(f, "IHDR", ihdr, sizeof(ihdr));
+
+    // Fluxo zlib: cabeçalho, blocos "stored" de até 65535 bytes e Adler-32
+    size_t total = scratch.size();
+    size_t numBlocks = total / 65535 + 1;
+    std::vector<unsigned char>& idat = frame.encodeBuffer;
+    idat.clear();
+    idat.reserve(2 + total + numBlocks * 5 + 4);
+    idat.push_back(0x78); idat.push_back(0x01);
+    unsigned int a = 1, b = 0;
+    for (size_t pos = 0; pos < total || pos == 0; ) {
+        size_t len = total - pos < 65535 ? total - pos : 65535;
+        bool last = pos + len >= total;
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(len & 0xFF); idat.push_back(len >> 8);
+        idat.push_back(~len & 0xFF); idat.push_back((~len >> 8) & 0xFF);
+        idat.insert(idat.end(), scratch.begin() + pos, scratch.begin() + pos + len);
+        for (size_t i = pos; i < pos + len; ++i) {
+            a = (a + scratch[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += len;
+        if (last) break;
+    }
+    unsigned int adler = (b << 16) | a;
+    idat.push_back(adler >> 24); idat.push_back(adler >> 16); idat.push_back(adler >> 8); idat.push_back(adler);
+    writePngChunk(f, "IDAT", &idat[0], idat.size());
+    writePngChunk(f, "IEND", NULL, 0);
+    fclose(f);
+}
+
+// captureWriterLoop: Thread que consome a fila e grava cada quadro em disco.
+void captureWriterLoop() {
+    std::vector<unsigned char> scratch;
+    char path[1024];
+    for (;;) {
+        CapturedFrame* frame;
+        {
+            std::unique_lock<std::mutex> lock(captureQueue.mutex);
+            captureQueue.notEmpty.wait(lock, [] { return !captureQueue.pending.empty() || captureQueue.done; });
+            if (captureQueue.pending.empty()) return;
+            frame = captureQueue.pending.front();
+            captureQueue.pending.pop_front();
+        }
+        snprintf(path, sizeof(path), "%s_%05d.%s", capturePrefix, frame->index, capturePng ? "png" : "ppm");
+        encodeFrame(*frame, path, capturePng, scratch);
+        {
+            std::lock_guard<std::mutex> lock(captureQueue.mutex);
+            captureQueue.freeFrames.push_back(frame);
+            captureQueue.framesWritten++;
+        }
+        captureQueue.notFull.notify_one();
+    }
+}
+
+// startCapture: Reserva os buffers da fila e inicia a thread de gravação.
+void startCapture(int width, int height) {
+    for (int i = 0; i < CAPTURE_QUEUE_CAPACITY; ++i) {
+        CapturedFrame* frame = new CapturedFrame();
+        frame->width = width;
+        frame->height = height;
+        frame->pixels.resize((size_t)width * height * 4);
+        captureQueue.freeFrames.push_back(frame);
+    }
+    glGenBuffers(2, capturePixelBuffers);
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capturePixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    captureThread = std::thread(captureWriterLoop);
+}
+
+// enqueueCapturedPixels: Copia o pixel buffer já lido para um buffer livre e o enfileira.
+void enqueueCapturedPixels(GLuint pixelBuffer, int index) {
+    CapturedFrame* frame;
+    {
+        std::unique_lock<std::mutex> lock(captureQueue.mutex);
+        if (captureQueue.freeFrames.empty()) {
+            // Fila cheia: a gravação ficou para trás e o desenho precisa esperar
+            double waitStart = nowSeconds();
+            captureQueue.notFull.wait(lock, [] { return !captureQueue.freeFrames.empty(); });
+            captureQueue.stallSeconds += nowSeconds() - waitStart;
+        }
+        frame = captureQueue.freeFrames.back();
+        captureQueue.freeFrames.pop_back();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+    const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (data) memcpy(&frame->pixels[0], data, frame->pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    frame->index = index;
+    {
+        std::lock_guard<std::mutex> lock(captureQueue.mutex);
+        captureQueue.pending.push_back(frame);
+    }
+    captureQueue.notEmpty.notify_one();
+}
+
+// captureFrame: Inicia a leitura assíncrona do quadro atual e enfileira o anterior.
+void captureFrame(int index, int width, int height) {
+    GLuint current = capturePixelBuffers[index % 2];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, current);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (index > 0) enqueueCapturedPixels(capturePixelBuffers[(index - 1) % 2], index - 1);
+}
+
+// finishCapture: Enfileira o último quadro, espera a thread terminar e libera os buffers.
+void finishCapture(int numFrames) {
+    if (numFrames > 0) enqueueCapturedPixels(capturePixelBuffers[(numFrames - 1) % 2], numFrames - 1);
+    {
+        std::lock_guard<std::mutex> lock(captureQueue.mutex);
+        captureQueue.done = true;
+    }
+    captureQueue.notEmpty.notify_one();
+    captureThread.join();
+    for (int i = 0; i < (int)captureQueue.freeFrames.size(); ++i) delete captureQueue.freeFrames[i];
+    captureQueue.freeFrames.clear();
+    glDeleteBuffers(2, capturePixelBuffers);
+}
+
+// runOffscreen: Simula e desenha numFrames quadros sem janela, um passo por quadro,
+// gravando-os se --capture foi pedido, e imprime a vazão de desenho.
+int runOffscreen(int numFrames) {
+    if (!createOffscreenContext(windowWidth, windowHeight)) return 1;
+    init();
+    resetGame(world.seed);
+    if (capturePrefix) startCapture(windowWidth, windowHeight);
+
+    double start = nowSeconds();
+    double renderSeconds = 0.0;
+    for (int f = 0; f < numFrames; ++f) {
+        prevMotherPenguin = world.motherPenguin;
+        prevBabyPenguin = world.babyPenguin;
+        double simStart = nowSeconds();
+        if (arenaView) stepArena(arena); else advanceSession();
+        publishWorld(simStart);
+        renderAlpha = 1.0f;
+
+        double renderStart = nowSeconds();
+        renderFrame();
+        glFinish();
+        double renderEnd = nowSeconds();
+        renderSeconds += renderEnd - renderStart;
+        currentFrame.simMs = (renderStart - simStart) * 1000.0;
+        currentFrame.renderMs = (renderEnd - renderStart) * 1000.0;
+        currentFrame.steps = 1;
+        recordFrame();
+        if (capturePrefix) captureFrame(f, windowWidth, windowHeight);
+    }
+    if (capturePrefix) finishCapture(numFrames);
+    double wallSeconds = nowSeconds() - start;
+
+    printf("Quadros: %d (%dx%d) | Desenho medio: %.3f ms | Quadros/s: %.1f\n", numFrames,
+           windowWidth, windowHeight, numFrames > 0 ? renderSeconds * 1000.0 / numFrames : 0.0,
+           wallSeconds > 0.0 ? numFrames / wallSeconds : 0.0);
+    if (capturePrefix) {
+        printf("Capturados: %d em %s_*.%s | Espera por fila cheia: %.3f s\n", captureQueue.framesWritten,
+               capturePrefix, capturePng ? "png" : "ppm", captureQueue.stallSeconds);
+    }
+    printFrameTelemetry();
+    printf("Checksum: %016llx\n", arenaView ? arenaChecksum(arena) : worldChecksum(world));
+    return 0;
+}
+
+// ===================================================================
+// RETRATOS DO MUNDO E THREAD DA SIMULAÇÃO
+//
+// Na janela, a simulação roda numa thread própria no passo fixo e publica
+// um retrato por passo num buffer triplo sem trava; a thread da GLUT só
+// desenha o retrato mais novo. Um quadro lento não atrasa a simulação e um
+// passo lento não segura o quadro. Com --no-sim-thread, o timer da GLUT
+// simula como antes e publica no mesmo buffer. --stress-snapshots N põe um
+// escritor e um leitor para disputar o buffer e confere cada retrato lido.
+// ===================================================================
+
+// copyPoolColumns: Copia as entidades ativas de um pool (colunas e count) para outro.
+template <int N>
+void copyPoolColumns(EntityPool<N>& dst, const EntityPool<N>& src) {
+    for (int c = 0; c < N; ++c) dst.columns[c].reserve(src.columns[c].size()); // Capacidade toda, uma vez
+    for (int c = 0; c < N; ++c) dst.columns[c].assign(src.columns[c].begin(), src.columns[c].begin() + src.count);
+    dst.count = src.count;
+}
+
+// captureWorld: Copia para o retrato o que o desenho lê de uma partida.
+void captureWorld(const GameWorld& w, const Penguin& prevMother, const Penguin& prevBaby, long long step,
+                  WorldSnapshot& s) {
+    s.step = step;
+    s.seed = w.seed;
+    s.gameState = w.gameState;
+    s.gameTime = w.gameTime;
+    s.babyEnergyTime = w.babyEnergyTime;
+    s.icePlatformSize = w.params.icePlatformSize;
+    s.prevMotherPenguin = prevMother;
+    s.prevBabyPenguin = prevBaby;
+    s.motherPenguin = w.motherPenguin;
+    s.babyPenguin = w.babyPenguin;
+    copyPoolColumns(s.fishes, w.fishes);
+    copyPoolColumns(s.holes, w.holes);
+    s.checksum = 0;
+}
+
+// publishSnapshot: Entrega o retrato de escrita e fica com o do meio para o próximo passo.
+void publishSnapshot(SnapshotBuffer& buffer) {
+    buffer.back = buffer.middle.exchange(buffer.back | SNAPSHOT_FRESH, std::memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+}
+
+// publishWorld: Publica o estado atual da partida da janela.
+void publishWorld(double simClock) {
+    WorldSnapshot& s = worldSnapshots.slots[worldSnapshots.back];
+    captureWorld(world, prevMotherPenguin, prevBabyPenguin, sessionStep, s);
+    s.simClock = simClock;
+    s.simMsTotal = simMsTotal;
+    publishSnapshot(worldSnapshots);
+}
+
+// acquireSnapshot: Retorna o retrato mais novo. Sem publicação nova, repete o último lido.
+const WorldSnapshot& acquireSnapshot(SnapshotBuffer& buffer) {
+    if (buffer.middle.load(std::memory_order_relaxed) & SNAPSHOT_FRESH) {
+        buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+    }
+    return buffer.slots[buffer.front];
+}
+
+// snapshotChecksum: Hash de todo o conteúdo de um retrato.
+unsigned long long snapshotChecksum(const WorldSnapshot& s) {
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    h = hashBytes(h, &s.step, sizeof(s.step));
+    h = hashBytes(h, &s.seed, sizeof(s.seed));
+    h = hashBytes(h, &s.gameState, sizeof(s.gameState));
+    h = hashBytes(h, &s.gameTime, sizeof(s.gameTime));
+    h = hashBytes(h, &s.babyEnergyTime, sizeof(s.babyEnergyTime));
+    h = hashPenguin(h, s.prevMotherPenguin);
+    h = hashPenguin(h, s.prevBabyPenguin);
+    h = hashPenguin(h, s.motherPenguin);
+    h = hashPenguin(h, s.babyPenguin);
+    h = hashBytes(h, &s.fishes.count, sizeof(int));
+    for (int c = 0; c < FISH_NUM_COLUMNS; ++c) h = hashBytes(h, s.fishes.column(c), s.fishes.count * sizeof(float));
+    h = hashBytes(h, &s.holes.count, sizeof(int));
+    for (int c = 0; c < HOLE_NUM_COLUMNS; ++c) h = hashBytes(h, s.holes.column(c), s.holes.count * sizeof(float));
+    return h;
+}
+
+// simThreadLoop: Passo fixo no relógio real. Dorme até o próximo passo vencer e, se
+// ficou para trás mais que MAX_FRAME_TIME, descarta o atraso em vez de correr atrás.
+void simThreadLoop() {
+    double simClock = nowSeconds();
+    while (!simThreadStop.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lock(inputMutex);
+            if (simIdleLocked()) { // Nada mudaria: dorme até chegar entrada, sem gastar passos
+                inputArrived.wait_for(lock, std::chrono::duration<double>(IDLE_SIM_WAIT));
+                simClock = nowSeconds() - SIM_DELTA_TIME; // O tempo parado não é recuperado
+                continue;
+            }
+        }
+        double now = nowSeconds();
+        double due = simClock + SIM_DELTA_TIME;
+        if (now < due) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(due - now));
+            continue;
+        }
+        if (now - due > MAX_FRAME_TIME) {
+            long long skipped = (long long)((now - due) / SIM_DELTA_TIME);
+            droppedSteps += skipped;
+            simClock += skipped * SIM_DELTA_TIME;
+        }
+        prevMotherPenguin = world.motherPenguin;
+        prevBabyPenguin = world.babyPenguin;
+        advanceSession();
+        simClock += SIM_DELTA_TIME;
+        simMsTotal += (nowSeconds() - now) * 1000.0;
+        publishWorld(simClock);
+    }
+}
+
+// startSimThread: Tira a simulação da thread da GLUT.
+void startSimThread() {
+    profileThreadIndex(); // A thread da GLUT fica com o índice 0 no trace
+    simThreadStop.store(false);
+    simThreadRunning = true;
+    simThread = std::thread(simThreadLoop);
+}
+
+// stopSimThread: Para a simulação e espera a thread terminar.
+void stopSimThread() {
+    if (!simThreadRunning) return;
+    simThreadStop.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        inputArrived.notify_all();
+    }
+    simThread.join();
+    simThreadRunning = false;
+}
+
+// Escritor e leitor do teste de estresse, com uma partida cheia só deles
+struct SnapshotStress {
+    SnapshotBuffer buffer;
+    GameWorld world;
+    int publications;
+    std::atomic<bool> done;
+};
+
+// stressWriterLoop: Simula com teclas sorteadas e publica um retrato por passo, sem pausa.
+void stressWriterLoop(SnapshotStress* stress) {
+    GameWorld& w = stress->world;
+    for (int i = 1; i <= stress->publications; ++i) {
+        Penguin prevMother = w.motherPenguin, prevBaby = w.babyPenguin;
+        applyControls(w, (int)(randomFloat(w.rng) * 16.0f), SIM_DELTA_TIME);
+        simulateStep(w, SIM_DELTA_TIME);
+        if (w.gameState != 0) resetWorld(w, w.seed + 1);
+        WorldSnapshot& s = stress->buffer.slots[stress->buffer.back];
+        captureWorld(w, prevMother, prevBaby, i, s);
+        s.checksum = snapshotChecksum(s);
+        publishSnapshot(stress->buffer);
+    }
+    stress->done.store(true, std::memory_order_release);
+}
+
+// runSnapshotStress: Lê retratos enquanto o escritor publica e confere que nenhum veio
+// misturado (hash diferente do gravado pelo escritor) nem fora de ordem.
+int runSnapshotStress(int publications) {
+    SnapshotStress* stress = new SnapshotStress(); // Grande demais para a pilha
+    stress->buffer.reset();
+    stress->publications = publications;
+    stress->done.store(false);
+    GameWorld& w = stress->world;
+    w.params = DEFAULT_GAME_PARAMS;
+    w.params.maxFish = w.params.maxHoles = STRESS_ENTITIES;
+    w.params.icePlatformSize = 40.0f;
+    w.params.fishSpawnInterval = w.params.holeSpawnInterval = SIM_DELTA_TIME;
+    resetWorld(w, world.seed);
+
+    double start = nowSeconds();
+    std::thread writer(stressWriterLoop, stress);
+    long long lastStep = 0, reads = 0, torn = 0, outOfOrder = 0;
+    for (;;) {
+        bool finished = stress->done.load(std::memory_order_acquire);
+        const WorldSnapshot& s = acquireSnapshot(stress->buffer);
+        if (s.step == lastStep) {
+            std::this_thread::yield(); // Nada novo: deixa o escritor andar (importa com um núcleo só)
+        } else {
+            reads++;
+            if (snapshotChecksum(s) != s.checksum) torn++;
+            if (s.step < lastStep) outOfOrder++;
+            lastStep = s.step;
+        }
+        if (finished && !(stress->buffer.middle.load() & SNAPSHOT_FRESH)) break;
+    }
+    writer.join();
+    double wallSeconds = nowSeconds() - start;
+
+    printf("Retratos: %d publicados, %lld lidos em %.3f s | Rasgados: %lld | Fora de ordem: %lld | Ultimo: %lld\n",
+           publications, reads, wallSeconds, torn, outOfOrder, lastStep);
+    bool ok = torn == 0 && outOfOrder == 0 && lastStep == publications;
+    delete stress;
+    return ok ? 0 : 1;
+}
+
+// ===================================================================
+// BENCHMARKS (--bench)
+//
+// Micro e macro benchmarks dos caminhos quentes, todos com a semente fixa
+// BENCH_SEED para que os casos sejam os mesmos em qualquer commit. Cada caso
+// calibra um lote que dure BENCH_SAMPLE_SECONDS e mede benchSamples lotes;
+// a tabela e o CSV (--bench-out) trazem mediana, p99 e mínimo por operação.
+// Com --bench-baseline o resultado é comparado a um CSV anterior e a saída
+// é 1 se alguma mediana piorou mais que benchRegressionThreshold.
+// ===================================================================
+
+// benchCheckCollision: Testa pares de esferas espalhadas numa área do tamanho da plataforma.
+void benchCheckCollision(void* context, int iterations) {
+    CollisionBench& bench = *(CollisionBench*)context;
+    int n = bench.a.size();
+    int hits = 0;
+    for (int i = 0; i < iterations; ++i) {
+        hits += checkCollision(bench.a[i % n], 0.3f, bench.b[(i * 7 + 1) % n], 0.4f);
+    }
+    bench.hits += hits; // Mantém o resultado vivo
+}
+
+// benchSpawnFish: Gera um peixe e remove outro sorteado, com o pool sempre pela metade.
+void benchSpawnFish(void* context, int iterations) {
+    GameWorld& w = *(GameWorld*)context;
+    for (int i = 0; i < iterations; ++i) {
+        if (!spawnFish(w)) continue; // Sem lugar: mede só o custo limitado da procura
+        int victim = std::min((int)(randomFloat(w.rng) * w.fishes.count), w.fishes.count - 1);
+        w.fishGrid.remove(w.fishes.denseToSlot[victim]);
+        w.fishes.despawn(victim);
+    }
+}
+
+// benchSpawnHole: Gera um buraco e remove outro sorteado, com o pool sempre pela metade.
+void benchSpawnHole(void* context, int iterations) {
+    GameWorld& w = *(GameWorld*)context;
+    for (int i = 0; i < iterations; ++i) {
+        if (!spawnHole(w)) continue;
+        int victim = std::min((int)(randomFloat(w.rng) * w.holes.count), w.holes.count - 1);
+        despawnHole(w, victim);
+    }
+}
+
+// benchTimerWheel: Um passo da agenda por operação: cancela e remarca um evento sorteado,
+// anda um passo e remarca os que dispararam, mantendo o número de pendentes.
+void benchTimerWheel(void* context, int iterations) {
+    TimerBench& b = *(TimerBench*)context;
+    int n = b.handles.size();
+    for (int i = 0; i < iterations; ++i) {
+        int victim = std::min((int)(randomFloat(b.rng) * n), n - 1);
+        b.wheel.cancel(b.handles[victim]);
+        b.handles[victim] = b.wheel.schedule(b.step + 1 + (long long)(randomFloat(b.rng) * b.horizon),
+                                             TIMER_BENCH, victim);
+        b.wheel.advance(++b.step);
+        for (int k = 0; k < (int)b.wheel.fired.size(); ++k) {
+            int target = b.wheel.fired[k].target;
+            b.handles[target] = b.wheel.schedule(b.step + 1 + (long long)(randomFloat(b.rng) * b.horizon),
+                                                 TIMER_BENCH, target);
+        }
+    }
+}
+
+// benchVecEnvStep: Um passo do lote inteiro de partidas por operação, na própria thread.
+void benchVecEnvStep(void* context, int iterations) {
+    EnvBench& b = *(EnvBench*)context;
+    for (int i = 0; i < iterations; ++i)
+        stepVecEnv(b.env, b.actions.data(), b.observations.data(), b.rewards.data(), b.dones.data());
+}
+
+// benchTimerStep: O passo que timer() faz por quadro: teclas seguradas e simulateStep.
+// O pinguim anda em círculo e a partida nunca termina, para o custo ficar estável.
+void benchTimerStep(void* context, int iterations) {
+    GameWorld& w = *(GameWorld*)context;
+    for (int i = 0; i < iterations; ++i) {
+        applyControls(w, CONTROL_FORWARD | CONTROL_TURN_LEFT, SIM_DELTA_TIME);
+        simulateStep(w, SIM_DELTA_TIME);
+        w.gameState = 0;
+        w.gameTime = 0.0f;
+        refillBabyEnergy(w);
+    }
+}
+
+// benchDrawPenguin: Grava e descarrega na fila de desenho um pinguim por operação.
+void benchDrawPenguin(void* context, int iterations) {
+    const Penguin& p = *(const Penguin*)context;
+    beginRenderQueue();
+    for (int i = 0; i < iterations; ++i) drawPenguin(p);
+    flushRenderQueue();
+    glFinish();
+    frameArena.reset(); // Sem recordFrame aqui: a fila gravada é liberada à mão
+}
+
+// benchDrawScene: Um quadro completo (cena e HUD) por operação, esperando o rasterizador.
+void benchDrawScene(void* context, int iterations) {
+    for (int i = 0; i < iterations; ++i) {
+        renderFrame();
+        glFinish();
+        frameArena.reset();
+    }
+}
+
+// setupBenchWorld: Prepara um mundo com entities peixes e buracos, na densidade do jogo padrão.
+void setupBenchWorld(GameWorld& w, int entities) {
+    w.params = DEFAULT_GAME_PARAMS;
+    w.params.maxFish = w.params.maxHoles = entities;
+    w.params.icePlatformSize = std::max(1.0f, sqrtf(entities / 5.0f)) * DEFAULT_GAME_PARAMS.icePlatformSize;
+    resetWorld(w, BENCH_SEED);
+    for (int i = 0; i < entities; ++i) {
+        spawnFish(w);
+        spawnHole(w);
+    }
+}
+
+// runBench: Calibra o lote de uma função, mede benchSamples lotes e guarda a estatística.
+void runBench(const char* name, int param, BenchFunction function, void* context) {
+    if (benchFilter && !strstr(name, benchFilter)) return;
+    // Uma execução de aquecimento (caches, compilação de shaders do driver) e depois
+    // dobra o lote até uma execução passar da duração alvo
+    function(context, 1);
+    int iterations = 1;
+    for (;;) {
+        double start = nowSeconds();
+        function(context, iterations);
+        if (nowSeconds() - start >= BENCH_SAMPLE_SECONDS || iterations >= (1 << 30)) break;
+        iterations *= 2;
+    }
+    std::vector<double> ns(benchSamples);
+    for (int s = 0; s < benchSamples; ++s) {
+        double start = nowSeconds();
+        function(context, iterations);
+        ns[s] = (nowSeconds() - start) * 1e9 / iterations;
+    }
+    std::sort(ns.begin(), ns.end());
+
+    BenchResult r;
+    r.name = name;
+    r.param = param;
+    r.samples = benchSamples;
+    r.iterations = iterations;
+    r.medianNs = ns[benchSamples / 2];
+    r.p99Ns = ns[std::min(benchSamples - 1, (int)ceil(benchSamples * 0.99) - 1)];
+    r.minNs = ns[0];
+    benchResults.push_back(r);
+    printf("%-16s %8d %10d %14.1f %14.1f %14.1f %14.0f\n", name, param, iterations,
+           r.medianNs, r.p99Ns, r.minNs, 1e9 / r.medianNs);
+    fflush(stdout);
+}
+
+// compareBenchBaseline: Compara as medianas com as de um CSV anterior; devolve quantas pioraram.
+int compareBenchBaseline(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { perror(path); return 0; }
+    char line[256];
+    int regressions = 0;
+    printf("\nComparacao com %s (mediana atual / anterior):\n", path);
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        int param;
+        double medianNs;
+        if (sscanf(line, "%63[^,],%d,%*d,%*d,%lf", name, &param, &medianNs) != 3) continue; // Cabeçalho
+        for (int i = 0; i < (int)benchResults.size(); ++i) {
+            const BenchResult& r = benchResults[i];
+            if (r.name != name || r.param != param) continue;
+            double ratio = medianNs > 0.0 ? r.medianNs / medianNs : 1.0;
+            bool regressed = ratio > benchRegressionThreshold;
+            regressions += regressed;
+            printf("%-16s %8d %8.3fx%s\n", name, param, ratio, regressed ? "  PIOROU" : "");
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+// runBenchmarks: Roda todos os casos (ou os que contêm --bench-filter no nome) e grava o CSV.
+int runBenchmarks() {
+    printf("%-16s %8s %10s %14s %14s %14s %14s\n", "caso", "tamanho", "lote", "mediana ns", "p99 ns", "min ns", "ops/s");
+
+    CollisionBench collision;
+    GameRng rng;
+    seedRng(rng, BENCH_SEED);
+    for (int i = 0; i < 1024; ++i) {
+        Position a = {(randomFloat(rng) - 0.5f) * 10.0f, 0.48f, (randomFloat(rng) - 0.5f) * 10.0f};
+        Position b = {(randomFloat(rng) - 0.5f) * 10.0f, 0.0f, (randomFloat(rng) - 0.5f) * 10.0f};
+        collision.a.push_back(a);
+        collision.b.push_back(b);
+    }
+    collision.hits = 0;
+    runBench("checkCollision", 1024, benchCheckCollision, &collision);
+
+    GameWorld* bench = new GameWorld(); // Grande demais para a pilha com os pools cheios
+    const int spawnSizes[2] = {16, 1024};
+    for (int s = 0; s < 2; ++s) {
+        setupBenchWorld(*bench, spawnSizes[s]);
+        for (int i = 0; i < spawnSizes[s] / 2; ++i) { // Deixa só metade dos peixes
+            bench->fishGrid.remove(bench->fishes.denseToSlot[0]);
+            bench->fishes.despawn(0);
+        }
+        runBench("spawnFish", spawnSizes[s], benchSpawnFish, bench);
+        setupBenchWorld(*bench, spawnSizes[s]);
+        for (int i = 0; i < spawnSizes[s] / 2; ++i) despawnHole(*bench, 0);
+        runBench("spawnHole", spawnSizes[s], benchSpawnHole, bench);
+    }
+    // Pior caso da geração: milhares de buracos na plataforma padrão, já saturada
+    bench->params = DEFAULT_GAME_PARAMS;
+    bench->params.maxHoles = SATURATED_SPAWN_HOLES;
+    resetWorld(*bench, BENCH_SEED);
+    for (int i = 0; i < SATURATED_SPAWN_HOLES; ++i) spawnHole(*bench);
+    runBench("spawnHoleSaturated", SATURATED_SPAWN_HOLES, benchSpawnHole, bench);
+
+    const int sceneSizes[3] = {5, 100, 1000};
+    for (int s = 0; s < 3; ++s) {
+        setupBenchWorld(*bench, sceneSizes[s]);
+        runBench("timerStep", sceneSizes[s], benchTimerStep, bench);
+    }
+    delete bench;
+
+    // Com atrasos de até 2n passos dispara em média um evento por passo, qualquer que seja n:
+    // o custo por operação deve ficar plano se marcar, cancelar e disparar forem O(1)
+    const int timerSizes[3] = {1024, 16384, 262144};
+    for (int s = 0; s < 3; ++s) {
+        TimerBench* timers = new TimerBench();
+        seedRng(timers->rng, BENCH_SEED);
+        timers->step = 0;
+        timers->horizon = 2 * timerSizes[s];
+        timers->wheel.reset(0, timerSizes[s]);
+        timers->handles.resize(timerSizes[s]);
+        for (int i = 0; i < timerSizes[s]; ++i) {
+            timers->handles[i] = timers->wheel.schedule(1 + (long long)(randomFloat(timers->rng) * timers->horizon),
+                                                        TIMER_BENCH, i);
+        }
+        runBench("timerWheel", timerSizes[s], benchTimerWheel, timers);
+        delete timers;
+    }
+
+    const int envSizes[2] = {64, 1024};
+    for (int s = 0; s < 2; ++s) {
+        EnvBench* envs = new EnvBench();
+        GameRng rng;
+        seedRng(rng, BENCH_SEED);
+        initVecEnv(envs->env, envSizes[s], DEFAULT_GAME_PARAMS);
+        envs->actions.resize(envSizes[s]);
+        for (int i = 0; i < envSizes[s]; ++i) envs->actions[i] = (int)(randomFloat(rng) * 16.0f);
+        envs->observations.resize((size_t)envSizes[s] * OBS_SIZE);
+        envs->rewards.resize(envSizes[s]);
+        envs->dones.resize(envSizes[s]);
+        resetVecEnv(envs->env, BENCH_SEED, envs->observations.data());
+        runBench("vecEnvStep", envSizes[s], benchVecEnvStep, envs);
+        delete envs;
+    }
+
+    // Desenho num contexto de software, se houver; sem ele só os casos da simulação valem
+    bool wantsRender = !benchFilter || strstr("drawPenguin", benchFilter) || strstr("drawScene", benchFilter);
+    if (wantsRender && createOffscreenContext(windowWidth, windowHeight)) {
+        init();
+        cameraSelected = 4; // Câmera fixa que enxerga a plataforma inteira
+        renderAlpha = 1.0f;
+        for (int s = 0; s < 3; ++s) {
+            setupBenchWorld(world, sceneSizes[s]);
+            prevMotherPenguin = world.motherPenguin;
+            prevBabyPenguin = world.babyPenguin;
+            publishWorld(nowSeconds());
+            if (s == 0) {
+                renderFrame(); // Deixa a projeção e a câmera da cena montadas
+                runBench("drawPenguin", 1, benchDrawPenguin, &world.motherPenguin);
+            }
+            runBench("drawScene", sceneSizes[s], benchDrawScene, NULL);
+        }
+    }
+
+    if (benchOutputPath) {
+        FILE* f = fopen(benchOutputPath, "w");
+        if (!f) { perror(benchOutputPath); return 1; }
+        fprintf(f, "name,param,samples,iterations,median_ns,p99_ns,min_ns,ops_per_s\n");
+        for (int i = 0; i < (int)benchResults.size(); ++i) {
+            const BenchResult& r = benchResults[i];
+            fprintf(f, "%s,%d,%d,%d,%.2f,%.2f,%.2f,%.0f\n", r.name.c_str(), r.param, r.samples, r.iterations,
+                    r.medianNs, r.p99Ns, r.minNs, 1e9 / r.medianNs);
+        }
+        fclose(f);
+        printf("Resultados gravados em %s\n", benchOutputPath);
+    }
+    if (benchBaselinePath && compareBenchBaseline(benchBaselinePath) > 0) return 1;
+    return 0;
+}
+
+// ===================================================================
+// ARENA DO QUADRO E CONTAGEM DE ALOCAÇÕES
+// ===================================================================
+
+#if PENGUIN_ALLOC_COUNTER
+// operator new: Substitui o global só para contar as chamadas; quem mede é recordFrame.
+// Fora de linha para o GCC não casar o malloc daqui com o delete de quem chamou.
+__attribute__((noinline)) void* operator new(size_t bytes) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(bytes ? bytes : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+#endif
+
+// FrameArena::allocate: Reserva bytes alinhados no bloco; sem espaço, num bloco avulso.
+void* FrameArena::allocate(size_t bytes, size_t align) {
+    size_t offset = (used + align - 1) & ~(align - 1);
+    if (offset + bytes <= capacity) {
+        used = offset + bytes;
+        if (used + overflowBytes > highWater) highWater = used + overflowBytes;
+        return base + offset;
+    }
+    // new[] devolve memória alinhada para qualquer tipo fundamental
+    char* block = new char[bytes];
+    overflow.push_back(block);
+    overflowBytes += bytes + align;
+    if (used + overflowBytes > highWater) highWater = used + overflowBytes;
+    return block;
+}
+
+// FrameArena::reset: Libera tudo o que o quadro usou e, se algo transbordou, cresce o
+// bloco para caber o pico visto.
+void FrameArena::reset() {
+    if (overflowBytes > 0) {
+        for (int i = 0; i < (int)overflow.size(); ++i) delete[] overflow[i];
+        overflow.clear();
+        size_t grown = capacity ? capacity : FRAME_ARENA_INITIAL_BYTES;
+        while (grown < highWater) grown *= 2;
+        delete[] base;
+        base = new char[grown];
+        capacity = grown;
+    }
+    used = 0;
+    overflowBytes = 0;
+    epoch++;
+}
+
+// runAllocationCheck: Roda duas vezes fora da tela a mesma sequência (piloto automático,
+// com um reinício no meio) e exige que a segunda passada, com os buffers e o driver já
+// aquecidos pela primeira, não aloque nada. Retorna 0 se passar.
+int runAllocationCheck(int numFrames) {
+    if (!PENGUIN_ALLOC_COUNTER) {
+        fprintf(stderr, "--check-allocs requer o contador de alocacoes (build com -DPENGUIN_ALLOC_COUNTER=1)\n");
+        return 1;
+    }
+    if (!createOffscreenContext(windowWidth, windowHeight)) return 1;
+    init();
+    autopilotEnabled = true;
+    unsigned long long seed = world.seed;
+    long long passAllocations[2] = {0, 0};
+    int worstFrame = -1, worstAllocations = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        resetGame(seed);
+        for (int f = 0; f < numFrames; ++f) {
+            if (f == numFrames / 2) queueInput(INPUT_RESET, 0, seed + 1); // Como a tecla 'r'
+            prevMotherPenguin = world.motherPenguin;
+            prevBabyPenguin = world.babyPenguin;
+            advanceSession();
+            publishWorld(nowSeconds());
+            renderAlpha = 1.0f;
+            renderFrame();
+            glFinish();
+            recordInputLatency(nowSeconds(), renderView->step); // Esvazia a fila como display()
+            recordFrame();
+            int allocations = frameTimings[(frameCount - 1) % FRAME_HISTORY].allocations;
+            passAllocations[pass] += allocations;
+            if (pass == 1 && allocations > worstAllocations) {
+                worstAllocations = allocations;
+                worstFrame = f;
+            }
+        }
+    }
+    printf("Alocacoes: %lld no aquecimento, %lld na segunda passada (%d quadros cada)\n",
+           passAllocations[0], passAllocations[1], numFrames);
+    if (passAllocations[1] > 0) {
+        printf("FALHOU: o quadro %d alocou %d vezes\n", worstFrame, worstAllocations);
+        return 1;
+    }
+    printf("OK: nenhuma alocacao por quadro em regime\n");
+    return 0;
+}
+
+// ===================================================================
+// LOOP DA JANELA (GLUT)
+// ===================================================================
+
+// nowSeconds: Retorna o tempo do relógio monotônico em segundos.
+double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// timer: O loop principal do jogo. Consome o tempo real decorrido em passos fixos de
+// SIM_DELTA_TIME, limitando a recuperação para não entrar numa espiral de atraso, e
+// pede o quadro seguinte no prazo do ritmo, ou nenhum se a cena estiver parada.
+void timer(int value) {
+    if (value != pacerGeneration) return; // Substituído por wakePacer antes de disparar
+    double now = nowSeconds();
+    if (!simThreadRunning) { // Sem thread própria, a simulação roda aqui
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(inputMutex);
+            idle = simIdleLocked();
+        }
+        if (idle) { // O tempo parado não vira passos ao voltar
+            lastFrameClock = now;
+            simAccumulator = 0.0;
+        }
+        double frameTime = now - lastFrameClock;
+        lastFrameClock = now;
+        if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+        simAccumulator += frameTime;
+
+        int steps = 0;
+        while (simAccumulator >= SIM_DELTA_TIME && steps < MAX_STEPS_PER_FRAME) {
+            prevMotherPenguin = world.motherPenguin;
+            prevBabyPenguin = world.babyPenguin;
+            advanceSession();
+            simAccumulator -= SIM_DELTA_TIME;
+            steps++;
+        }
+        // Descarta o atraso que não coube no limite de passos
+        while (simAccumulator >= SIM_DELTA_TIME) {
+            simAccumulator -= SIM_DELTA_TIME;
+            droppedSteps++;
+        }
+        if (!idle) renderAlpha = (float)(simAccumulator / SIM_DELTA_TIME);
+        if (steps > 0) publishWorld(now - simAccumulator);
+
+        currentFrame.simMs += (nowSeconds() - now) * 1000.0;
+        currentFrame.steps += steps;
+    }
+
+    if (sceneStatic()) { // Nada novo para mostrar: confere de novo mais tarde
+        pacerIdle = true;
+        idlePolls++;
+        glutTimerFunc(IDLE_POLL_MS, timer, pacerGeneration);
+        return;
+    }
+    if (pacerIdle) { // Volta da espera: o ritmo recomeça agora, sem intervalo a medir
+        pacerIdle = false;
+        nextFrameDeadline = now;
+        lastSwapClock = 0.0;
+    }
+    glutPostRedisplay();
+    scheduleNextFrame(now);
+}
+
+// scheduleNextFrame: Marca o timer para o próximo prazo do ritmo. O prazo avança de um
+// período fixo, não a partir de agora, então atrasos pequenos são compensados no quadro
+// seguinte; atrás por mais de um período, o ritmo recomeça do instante atual.
+void scheduleNextFrame(double now) {
+    double period = frameCap > 0 ? 1.0 / frameCap : 0.0;
+    nextFrameDeadline += period;
+    if (nextFrameDeadline < now - period) nextFrameDeadline = now;
+    // Arredonda para baixo: a GLUT não dispara antes do pedido, e o prazo seguinte não depende deste atraso
+    int delayMs = (int)((nextFrameDeadline - now) * 1000.0);
+    glutTimerFunc(std::max(0, delayMs), timer, pacerGeneration);
+}
+
+// wakePacer: Pede um quadro por algo que a simulação não mostra (tecla, janela). Se o timer
+// estava no ritmo de espera, troca-o por um imediato em vez de aguardar a conferência.
+void wakePacer() {
+    redrawRequested = true;
+    if (!pacerIdle) return; // O timer do ritmo normal já vai desenhar
+    pacerGeneration++;
+    glutTimerFunc(0, timer, pacerGeneration);
+}
+
+// sceneStatic: Verdadeiro quando um quadro novo seria igual ao que está na tela: janela
+// escondida, ou partida pausada/terminada com o último retrato já desenhado.
+bool sceneStatic() {
+    if (windowHidden) return true;
+    if (redrawRequested) return false;
+    const WorldSnapshot& view = acquireSnapshot(worldSnapshots);
+    if (view.step != lastDrawnStep) return false;
+    return simPaused.load() || view.gameState != 0;
+}
+
+// simIdleLocked: Verdadeiro quando um passo não mudaria nada: pausa, ou fim de partida
+// sem entrada na fila. No replay os passos continuam, porque o log conta passos até o
+// próximo reinício. Chamada com inputMutex travado.
+bool simIdleLocked() {
+    if (simPaused.load()) return true;
+    if (replayPath || world.gameState == 0) return false;
+    return pendingInputs.empty();
+}
+
+// setPaused: Pausa ou retoma a simulação; ao retomar, acorda a thread que dorme.
+void setPaused(bool paused) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    simPaused.store(paused);
+    inputArrived.notify_one();
+}
+
+// visibility: Sem janela visível os quadros param; ao reaparecer, desenha de novo.
+void visibility(int state) {
+    windowHidden = state == GLUT_NOT_VISIBLE;
+    if (!windowHidden) wakePacer();
+}
+
+// applySwapInterval: Escolhe se a troca de buffers espera o retraço vertical, pela extensão
+// GLX que o driver tiver. Retorna o intervalo aplicado, ou -1 se nenhuma estiver disponível.
+int applySwapInterval(int interval) {
+#ifdef PENGUIN_HAS_GLX
+    Display* display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (!display || !drawable) return -1;
+    const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+    if (!extensions) return -1;
+    if (strstr(extensions, "GLX_EXT_swap_control")) {
+        typedef void (*SwapIntervalEXT)(Display*, GLXDrawable, int);
+        SwapIntervalEXT f = (SwapIntervalEXT)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalEXT");
+        if (f) {
+            f(display, drawable, interval);
+            swapControl = "GLX_EXT_swap_control";
+            return interval;
+        }
+    }
+    if (strstr(extensions, "GLX_MESA_swap_control")) {
+        typedef int (*SwapIntervalMESA)(unsigned int);
+        SwapIntervalMESA f = (SwapIntervalMESA)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+        if (f && f(interval) == 0) {
+            swapControl = "GLX_MESA_swap_control";
+            return interval;
+        }
+    }
+    if (interval > 0 && strstr(extensions, "GLX_SGI_swap_control")) { // A SGI não aceita 0
+        typedef int (*SwapIntervalSGI)(int);
+        SwapIntervalSGI f = (SwapIntervalSGI)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+        if (f && f(interval) == 0) {
+            swapControl = "GLX_SGI_swap_control";
+            return interval;
+        }
+    }
+#endif
+    return -1;
+}
+
+// interpolatePenguin: Mistura dois estados de um pinguim para desenhar entre passos.
+Penguin interpolatePenguin(const Penguin& prev, const Penguin& cur, float alpha) {
+    Penguin p = cur;
+    p.pos.x = prev.pos.x + (cur.pos.x - prev.pos.x) * alpha;
+    p.pos.y = prev.pos.y + (cur.pos.y - prev.pos.y) * alpha;
+    p.pos.z = prev.pos.z + (cur.pos.z - prev.pos.z) * alpha;
+    p.rotation = prev.rotation + (cur.rotation - prev.rotation) * alpha;
+    p.wingAnimation = prev.wingAnimation + (cur.wingAnimation - prev.wingAnimation) * alpha;
+    return p;
+}
+
+// recordFrame: Guarda as medições do quadro atual no histórico circular.
+void recordFrame() {
+    profileEndFrame();
+    long long allocations = heapAllocations.load(std::memory_order_relaxed);
+    currentFrame.allocations = (int)(allocations - frameStartAllocations);
+    frameStartAllocations = allocations;
+    frameTimings[frameCount % FRAME_HISTORY] = currentFrame;
+    frameCount++;
+    currentFrame = FrameTiming();
+    frameArena.reset();
+}
+
+// recordInputLatency: Fecha a medição das entradas que este quadro já mostra, isto é,
+// as aplicadas antes de shownStep, o passo do retrato desenhado.
+void recordInputLatency(double swapTime, long long shownStep) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    int kept = 0;
+    for (int i = 0; i < (int)latencyWaiting.size(); ++i) {
+        if (latencyWaiting[i].step >= shownStep) {
+            latencyWaiting[kept++] = latencyWaiting[i];
+            continue;
+        }
+        inputLatencyMs[latencyCount % LATENCY_HISTORY] = (swapTime - latencyWaiting[i].timestamp) * 1000.0;
+        latencyCount++;
+    }
+    latencyWaiting.resize(kept);
+}
+
+// printFrameTelemetry: Imprime médias e máximos do histórico e, se pedido, grava o CSV.
+void printFrameTelemetry() {
+    int n = frameCount < FRAME_HISTORY ? (int)frameCount : FRAME_HISTORY;
+    if (n == 0) return;
+
+    FrameTiming avg = FrameTiming(), worst = FrameTiming();
+    for (int i = 0; i < n; ++i) {
+        const FrameTiming& f = frameTimings[i];
+        avg.simMs += f.simMs; avg.renderMs += f.renderMs; avg.swapMs += f.swapMs;
+        avg.drawCalls += f.drawCalls;
+        avg.stateIssued += f.stateIssued;
+        avg.stateSkipped += f.stateSkipped;
+        avg.entitiesDrawn += f.entitiesDrawn;
+        avg.entitiesCulled += f.entitiesCulled;
+        avg.textLayouts += f.textLayouts;
+        avg.allocations += f.allocations;
+        if (f.allocations > worst.allocations) worst.allocations = f.allocations;
+        if (f.simMs > worst.simMs) worst.simMs = f.simMs;
+        if (f.renderMs > worst.renderMs) worst.renderMs = f.renderMs;
+        if (f.swapMs > worst.swapMs) worst.swapMs = f.swapMs;
+    }
+    printf("Quadros: %lld (ultimos %d) | Passos descartados: %lld\n", frameCount, n, droppedSteps);
+    printf("Simulacao: media %.3f ms, max %.3f ms\n", avg.simMs / n, worst.simMs);
+    printf("Desenho:   media %.3f ms, max %.3f ms\n", avg.renderMs / n, worst.renderMs);
+    printf("Troca:     media %.3f ms, max %.3f ms\n", avg.swapMs / n, worst.swapMs);
+    printf("Chamadas de desenho por quadro: %.1f (%s, %s)\n", (double)avg.drawCalls / n,
+           instancingAvailable ? "instanciado" : "por objeto",
+           rendererBackend == RENDERER_SHADER ? "shaders" : "pipeline fixo");
+    printf("Mudancas de estado por quadro: %.1f enviadas, %.1f descartadas\n",
+           (double)avg.stateIssued / n, (double)avg.stateSkipped / n);
+    printf("Entidades por quadro: %.1f desenhadas, %.1f fora da vista\n",
+           (double)avg.entitiesDrawn / n, (double)avg.entitiesCulled / n);
+    printf("Textos do HUD remontados por quadro: %.2f\n", (double)avg.textLayouts / n);
+    if (PENGUIN_ALLOC_COUNTER)
+        printf("Alocacoes no heap por quadro: media %.2f, max %d | Arena do quadro: pico %zu de %zu bytes\n",
+               (double)avg.allocations / n, worst.allocations, frameArena.highWater, frameArena.capacity);
+    if (latencyCount > 0) {
+        int m = latencyCount < LATENCY_HISTORY ? (int)latencyCount : LATENCY_HISTORY;
+        std::vector<double> sorted(inputLatencyMs, inputLatencyMs + m);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (int i = 0; i < m; ++i) sum += sorted[i];
+        printf("Latencia de entrada: media %.1f ms, p95 %.1f ms, max %.1f ms (%lld eventos)\n",
+               sum / m, sorted[(m * 95) / 100 < m ? (m * 95) / 100 : m - 1], sorted[m - 1], latencyCount);
+    }
+    // Intervalo entre trocas e o desvio dele em relação ao período pedido (a mediana, sem limite)
+    std::vector<double> intervals;
+    for (int i = 0; i < n; ++i)
+        if (frameTimings[i].intervalMs > 0.0) intervals.push_back(frameTimings[i].intervalMs);
+    if (!intervals.empty()) {
+        int m = (int)intervals.size();
+        std::sort(intervals.begin(), intervals.end());
+        double target = frameCap > 0 ? 1000.0 / frameCap : intervals[m / 2];
+        std::vector<double> jitter(m);
+        for (int i = 0; i < m; ++i) jitter[i] = fabs(intervals[i] - target);
+        std::sort(jitter.begin(), jitter.end());
+        printf("Intervalo entre quadros: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms (alvo %.2f ms)\n",
+               intervals[m / 2], intervals[(m * 95) / 100], intervals[(m * 99) / 100], intervals[m - 1], target);
+        printf("Variacao do ritmo: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms | Conferencias com a cena parada: %lld\n",
+               jitter[m / 2], jitter[(m * 95) / 100], jitter[(m * 99) / 100], idlePolls);
+    }
+
+    if (frameLogPath) {
+        FILE* f = fopen(frameLogPath, "w");
+        if (!f) { perror(frameLogPath); return; }
+        fprintf(f, "frame,sim_ms,render_ms,swap_ms,steps,draw_calls,state_issued,state_skipped,drawn,culled,allocs,interval_ms\n");
+        long long first = frameCount - n;
+        for (long long i = first; i < frameCount; ++i) {
+            const FrameTiming& t = frameTimings[i % FRAME_HISTORY];
+            fprintf(f, "%lld,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d,%.4f\n", i, t.simMs, t.renderMs, t.swapMs, t.steps,
+                    t.drawCalls, t.stateIssued, t.stateSkipped, t.entitiesDrawn, t.entitiesCulled, t.allocations,
+                    t.intervalMs);
+        }
+        fclose(f);
+    }
+}
+
+// ===================================================================
+// TRATAMENTO DE ENTRADA
+// ===================================================================
+
+// reshape: Chamada quando a janela é redimensionada.
+void reshape(int w, int h) {
+    if (h == 0) h = 1;
+    windowWidth = w;
+    windowHeight = h;
+    glViewport(0, 0, w, h);
+    wakePacer();
+}
+
+// keyboard: Trata os pressionamentos de teclas normais.
+void keyboard(unsigned char key, int x, int y) {
+    if (key == 27) exit(0); // ESC para sair
+    if (key == 'r' || key == 'R') { // Reinicia com a próxima semente
+        if (simPaused.load()) setPaused(false);
+        queueInput(INPUT_RESET, 0, acquireSnapshot(worldSnapshots).seed + 1);
+    }
+    wakePacer(); // Câmera, HUD e pausa mudam a tela mesmo com a cena parada
+
+    // Adiciona o switch para trocar a câmera
+    switch(key) {
+        case '1':
+            cameraSelected = 1;
+            break;
+        case '2':
+            cameraSelected = 2;
+            break;
+        case '3':
+            cameraSelected = 3;
+            break;
+        case '4':
+            cameraSelected = 4;
+            break;
+        case 'p': // Liga/desliga o profiler e o seu gráfico no HUD
+        case 'P':
+            profilerEnabled = !profilerEnabled;
+            break;
+        case 'a': // Liga/desliga o piloto automático; ao desligar voltam a valer as setas seguradas
+        case 'A':
+            autopilotEnabled = !autopilotEnabled;
+            if (!autopilotEnabled) queueInput(INPUT_KEYS, heldKeys, 0);
+            break;
+        case ' ': // Pausa/retoma a partida
+            setPaused(!simPaused.load());
+            break;
+    }
+}
+
+// controlKeyBit: Bit da máscara de controle correspondente a uma tecla especial da GLUT.
+int controlKeyBit(int key) {
+    switch (key) {
+        case GLUT_KEY_UP:    return CONTROL_FORWARD;
+        case GLUT_KEY_DOWN:  return CONTROL_BACKWARD;
+        case GLUT_KEY_LEFT:  return CONTROL_TURN_LEFT;
+        case GLUT_KEY_RIGHT: return CONTROL_TURN_RIGHT;
+    }
+    return 0;
+}
+
+// special: Marca uma tecla especial (ex: setas) como segurada.
+void special(int key, int x, int y) {
+    int bit = controlKeyBit(key);
+    if (!bit || (heldKeys & bit)) return;
+    heldKeys |= bit;
+    queueInput(INPUT_KEYS, heldKeys, 0); // Vale a partir do próximo passo da simulação
+    wakePacer();
+}
+
+// specialUp: Marca uma tecla especial como solta.
+void specialUp(int key, int x, int y) {
+    int bit = controlKeyBit(key);
+    if (!bit || !(heldKeys & bit)) return;
+    heldKeys &= ~bit;
+    queueInput(INPUT_KEYS, heldKeys, 0);
+    wakePacer();
+}
+
+// ===================================================================
+// MALHAS EM CACHE
+//
+// Os modelos são feitos de poucas primitivas (esfera, cone, disco e cubo
+// unitários) reaproveitadas por meio de transformações. Cada primitiva é
+// tesselada uma única vez em init() e gravada numa display list, então o
+// desenho de um quadro não recalcula nenhum vértice.
 // ===================================================================
 
-// checkCollision: Verifica a colisão entre duas esferas.
-bool checkCollision(Position p1, float r1, Position p2, float r2) {
-    float dx = p1.x - p2.x;
-    float dy = p1.y - p2.y;
-    float dz = p1.z - p2.z;
-    return (dx * dx + dy * dy + dz * dz) < (r1 + r2) * (r1 + r2);
+// addMeshVertex: Acrescenta um vértice com sua normal à malha.
+void addMeshVertex(Mesh& mesh, float x, float y, float z, float nx, float ny, float nz) {
+    mesh.vertices.push_back(x); mesh.vertices.push_back(y); mesh.vertices.push_back(z);
+    mesh.normals.push_back(nx); mesh.normals.push_back(ny); mesh.normals.push_back(nz);
+}
+
+// addMeshTriangle: Acrescenta um triângulo à malha.
+void addMeshTriangle(Mesh& mesh, int a, int b, int c) {
+    mesh.indices.push_back(a); mesh.indices.push_back(b); mesh.indices.push_back(c);
+}
+
+// buildSphereMesh: Esfera de raio 1, equivalente a glutSolidSphere(1.0, slices, stacks).
+void buildSphereMesh(Mesh& mesh, int slices, int stacks) {
+    for (int j = 0; j <= stacks; ++j) {
+        float phi = j * M_PI / stacks;
+        for (int i = 0; i <= slices; ++i) {
+            float theta = i * 2.0f * M_PI / slices;
+            float x = sin(phi) * cos(theta), y = sin(phi) * sin(theta), z = cos(phi);
+            addMeshVertex(mesh, x, y, z, x, y, z);
+        }
+    }
+    for (int j = 0; j < stacks; ++j) {
+        for (int i = 0; i < slices; ++i) {
+            int a = j * (slices + 1) + i;
+            int b = a + slices + 1;
+            addMeshTriangle(mesh, a, b, a + 1);
+            addMeshTriangle(mesh, a + 1, b, b + 1);
+        }
+    }
 }
 
-// spawnFish: Encontra um peixe inativo e o gera em um local aleatório.
-void spawnFish() {
-    for (int i = 0; i < fishes.size(); ++i) {
-        if (!fishes[i].active) {
-            float x = (rand() / (float)RAND_MAX - 0.5f) * ICE_PLATFORM_SIZE * 0.8f;
-            float z = (rand() / (float)RAND_MAX - 0.5f) * ICE_PLATFORM_SIZE * 0.8f;
-            fishes[i].pos = {x, 0.3f, z};
-            fishes[i].active = true;
-            fishes[i].animationTime = 0.0f;
-            fishes[i].bobHeight = 0.1f + (rand() / (float)RAND_MAX) * 0.2f;
-            return; // Gera um peixe de cada vez
+// buildConeMesh: Cone com base em z = 0 e ponta em z = height, como glutSolidCone.
+void buildConeMesh(Mesh& mesh, float base, float height, int slices, int stacks) {
+    float len = sqrt(base * base + height * height);
+    float nxy = height / len, nz = base / len;
+    for (int j = 0; j <= stacks; ++j) {
+        float z = j * height / stacks;
+        float r = base * (1.0f - (float)j / stacks);
+        for (int i = 0; i <= slices; ++i) {
+            float theta = i * 2.0f * M_PI / slices;
+            float c = cos(theta), s = sin(theta);
+            addMeshVertex(mesh, c * r, s * r, z, c * nxy, s * nxy, nz);
+        }
+    }
+    for (int j = 0; j < stacks; ++j) {
+        for (int i = 0; i < slices; ++i) {
+            int a = j * (slices + 1) + i;
+            int b = a + slices + 1;
+            addMeshTriangle(mesh, a, a + 1, b);
+            addMeshTriangle(mesh, a + 1, b + 1, b);
         }
     }
+    // Tampa da base, virada para -z
+    int center = mesh.vertices.size() / 3;
+    addMeshVertex(mesh, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f);
+    for (int i = 0; i <= slices; ++i) {
+        float theta = i * 2.0f * M_PI / slices;
+        addMeshVertex(mesh, cos(theta) * base, sin(theta) * base, 0.0f, 0.0f, 0.0f, -1.0f);
+    }
+    for (int i = 0; i < slices; ++i) {
+        addMeshTriangle(mesh, center, center + 2 + i, center + 1 + i);
+    }
+}
+
+// buildDiskMesh: Disco de raio 1 no plano y = 0 com a normal para cima.
+void buildDiskMesh(Mesh& mesh, int segments) {
+    addMeshVertex(mesh, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    for (int i = 0; i <= segments; ++i) {
+        float angle = i * 2.0f * M_PI / segments;
+        addMeshVertex(mesh, cos(angle), 0.0f, sin(angle), 0.0f, 1.0f, 0.0f);
+    }
+    for (int i = 0; i < segments; ++i) {
+        addMeshTriangle(mesh, 0, i + 1, i + 2);
+    }
 }
 
-// spawnHole: Encontra um buraco inativo e o gera em um local aleatório.
-void spawnHole() {
-    for (int i = 0; i < holes.size(); ++i) {
-        if (!holes[i].active) {
-             float x, z;
-            do {
-                x = (rand() / (float)RAND_MAX - 0.5f) * ICE_PLATFORM_SIZE * 0.8f;
-                z = (rand() / (float)RAND_MAX - 0.5f) * ICE_PLATFORM_SIZE * 0.8f;
-            } while (sqrt(x*x + z*z) < 2.0f); // Mantém longe do centro
+// buildCubeMesh: Cubo de lado 1 centrado na origem, como glutSolidCube(1.0).
+void buildCubeMesh(Mesh& mesh) {
+    static const float faces[6][3] = {
+        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+    };
+    for (int f = 0; f < 6; ++f) {
+        const float* n = faces[f];
+        // Dois eixos tangentes à face, com u x v = n
+        float u[3] = {0.0f, 0.0f, 0.0f};
+        if (n[0] != 0) u[1] = 1.0f; else if (n[1] != 0) u[2] = 1.0f; else u[0] = 1.0f;
+        float v[3] = {n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0]};
+        int first = mesh.vertices.size() / 3;
+        for (int k = 0; k < 4; ++k) {
+            float su = (k == 1 || k == 2) ? 0.5f : -0.5f;
+            float sv = (k >= 2) ? 0.5f : -0.5f;
+            addMeshVertex(mesh,
+                          n[0] * 0.5f + u[0] * su + v[0] * sv,
+                          n[1] * 0.5f + u[1] * su + v[1] * sv,
+                          n[2] * 0.5f + u[2] * su + v[2] * sv,
+                          n[0], n[1], n[2]);
+        }
+        addMeshTriangle(mesh, first, first + 1, first + 2);
+        addMeshTriangle(mesh, first, first + 2, first + 3);
+    }
+}
 
-            holes[i].pos = {x, 0.0f, z};
-            holes[i].active = true;
-            holes[i].animationTime = 0.0f;
-            holes[i].radius = 0.4f;
-            return; // Gera um buraco de cada vez
+// appendScaledMesh: Acrescenta src a dst com escala (sx, sy, sz), giro opcional de
+// 90 graus em y e translação, como as transformações do modelo do peixe.
+void appendScaledMesh(Mesh& dst, const Mesh& src, float sx, float sy, float sz, bool rotateY90,
+                      float tx, float ty, float tz) {
+    int first = dst.vertices.size() / 3;
+    for (int i = 0; i < (int)src.vertices.size(); i += 3) {
+        float x = src.vertices[i] * sx, y = src.vertices[i + 1] * sy, z = src.vertices[i + 2] * sz;
+        float nx = src.normals[i] / sx, ny = src.normals[i + 1] / sy, nz = src.normals[i + 2] / sz;
+        if (rotateY90) {
+            float t = x; x = z; z = -t;
+            t = nx; nx = nz; nz = -t;
         }
+        float len = sqrt(nx * nx + ny * ny + nz * nz);
+        addMeshVertex(dst, x + tx, y + ty, z + tz, nx / len, ny / len, nz / len);
     }
+    for (int i = 0; i < (int)src.indices.size(); ++i) dst.indices.push_back(first + src.indices[i]);
 }
 
-// timer: O loop principal do jogo, chamado periodicamente para atualizar o estado do jogo.
-void timer(int value) {
-    float deltaTime = 16.0f / 1000.0f;
+// uploadMesh: Grava a malha numa display list a partir dos seus vertex arrays.
+void uploadMesh(Mesh& mesh) {
+    mesh.displayList = glGenLists(1);
+    glNewList(mesh.displayList, GL_COMPILE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &mesh.vertices[0]);
+    glNormalPointer(GL_FLOAT, 0, &mesh.normals[0]);
+    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, &mesh.indices[0]);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glEndList();
+}
+
+// drawMesh: Desenha uma malha já carregada com a transformação atual.
+void drawMesh(const Mesh& mesh) {
+    submitMesh(mesh);
+}
 
-    if (gameState == 0) { // Se o jogo estiver em andamento
-        gameTime += deltaTime;
-        babyEnergyTime -= deltaTime;
+// buildMeshes: Tessela e carrega todas as primitivas usadas pelos modelos.
+void buildMeshes() {
+    for (int lod = 0; lod < NUM_LODS; ++lod) {
+        buildSphereMesh(sphereMeshes[lod], LOD_SPHERE_SLICES[lod], LOD_SPHERE_SLICES[lod]);
+        buildConeMesh(tailMeshes[lod], 0.04f, 0.07f, LOD_TAIL_SLICES[lod], LOD_TAIL_SLICES[lod] * 2 / 3);
+        uploadMesh(sphereMeshes[lod]);
+        uploadMesh(tailMeshes[lod]);
+    }
+    buildSphereMesh(eyeMesh, 10, 10);
+    buildConeMesh(beakMesh, 0.03f, 0.08f, 8, 4);
+    buildDiskMesh(diskMesh, 32);
+    buildCubeMesh(cubeMesh);
 
-        if (gameTime >= GAME_DURATION) gameState = 1; // Vitória
-        if (babyEnergyTime <= 0.0f) gameState = 2; // Derrota
+    Mesh* meshes[] = {&eyeMesh, &beakMesh, &diskMesh, &cubeMesh};
+    for (int i = 0; i < 4; ++i) uploadMesh(*meshes[i]);
 
-        // Atualiza as animações
-        if (motherPenguin.isMoving) {
-            motherPenguin.wingAnimation += deltaTime * 8.0f;
-        }
-        for (int i = 0; i < fishes.size(); ++i) {
-            if(fishes[i].active) fishes[i].animationTime += deltaTime * 3.0f;
-        }
-        for (int i = 0; i < holes.size(); ++i) {
-            if(holes[i].active) holes[i].animationTime += deltaTime * 2.0f;
+    // O corpo e a cauda do peixe não mudam, então o modelo inteiro (já na escala 1.5)
+    // vira uma única malha por nível, usada tanto por objeto quanto instanciada
+    for (int lod = 0; lod < NUM_LODS; ++lod) {
+        Mesh& mesh = fishModelMeshes[lod];
+        appendScaledMesh(mesh, sphereMeshes[lod], 0.15f, 0.06f, 0.075f, false, 0.0f, 0.0f, 0.0f);
+        appendScaledMesh(mesh, tailMeshes[lod], 1.5f, 1.5f, 1.5f, true, -0.15f, 0.0f, 0.0f);
+        uploadMesh(mesh);
+    }
+}
+
+// ===================================================================
+// DESENHO INSTANCIADO
+//
+// Quando o contexto oferece OpenGL 3.3 (o Mesa por software oferece), todos os
+// peixes e todos os buracos saem em uma única chamada instanciada cada. As
+// transformações por instância vão num buffer de vec4 e um shader GLSL 1.20
+// reproduz a iluminação por vértice e a névoa do pipeline fixo. Sem suporte,
+// ou com --no-instancing, drawScene volta ao caminho de um objeto por vez.
+// ===================================================================
+
+const GLuint INSTANCE_ATTRIB = 6;   // Atributo genérico com os dados da instância
+const int INSTANCE_FISH = 0;        // Tipos de instância entendidos pelo shader
+const int INSTANCE_HOLE = 1;
+
+const char* INSTANCE_VERTEX_SHADER =
+    "#version 120\n"
+    "attribute vec4 instanceData;\n"
+    "uniform int instanceKind;\n"
+    "varying vec4 color;\n"
+    "void main() {\n"
+    "    vec3 p = gl_Vertex.xyz;\n"
+    "    vec3 n = gl_Normal;\n"
+    "    if (instanceKind == 0) {\n"
+    "        // Peixe: xyz = posição já com o balanço, w = giro em graus\n"
+    "        float a = radians(instanceData.w);\n"
+    "        float c = cos(a), s = sin(a);\n"
+    "        p = vec3(c * p.x + s * p.z, p.y, -s * p.x + c * p.z);\n"
+    "        n = vec3(c * n.x + s * n.z, n.y, -s * n.x + c * n.z);\n"
+    "    } else {\n"
+    "        // Buraco: xyz = posição, w = raio\n"
+    "        p = vec3(p.x * instanceData.w, p.y + 0.02, p.z * instanceData.w);\n"
+    "    }\n"
+    "    vec4 world = vec4(p + instanceData.xyz, 1.0);\n"
+    "    vec4 eyePos = gl_ModelViewMatrix * world;\n"
+    "    vec3 N = normalize(gl_NormalMatrix * n);\n"
+    "    vec4 c = gl_FrontLightModelProduct.sceneColor;\n"
+    "    for (int i = 0; i < 2; ++i) {\n"
+    "        vec3 L = normalize(gl_LightSource[i].position.xyz - eyePos.xyz);\n"
+    "        float NdotL = max(dot(N, L), 0.0);\n"
+    "        c += gl_FrontLightProduct[i].ambient + gl_FrontLightProduct[i].diffuse * NdotL;\n"
+    "        if (NdotL > 0.0) {\n"
+    "            vec3 H = normalize(L + vec3(0.0, 0.0, 1.0));\n"
+    "            c += gl_FrontLightProduct[i].specular * pow(max(dot(N, H), 0.0), gl_FrontMaterial.shininess);\n"
+    "        }\n"
+    "    }\n"
+    "    color = vec4(c.rgb, gl_FrontMaterial.diffuse.a);\n"
+    "    gl_FogFragCoord = abs(eyePos.z);\n"
+    "    gl_Position = gl_ProjectionMatrix * eyePos;\n"
+    "}\n";
+
+const char* INSTANCE_FRAGMENT_SHADER =
+    "#version 120\n"
+    "varying vec4 color;\n"
+    "void main() {\n"
+    "    float f = clamp((gl_Fog.end - gl_FogFragCoord) * gl_Fog.scale, 0.0, 1.0);\n"
+    "    gl_FragColor = vec4(mix(gl_Fog.color.rgb, color.rgb, f), color.a);\n"
+    "}\n";
+
+// compileShader: Compila um shader e imprime o log em caso de erro.
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Erro ao compilar shader: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// uploadMeshBuffers: Copia os vertex arrays de uma malha para buffers na GPU.
+void uploadMeshBuffers(Mesh& mesh) {
+    if (mesh.vertexBuffer) return; // Já carregada pelo outro caminho
+    glGenBuffers(1, &mesh.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), &mesh.vertices[0], GL_STATIC_DRAW);
+    glGenBuffers(1, &mesh.normalBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.normals.size() * sizeof(float), &mesh.normals[0], GL_STATIC_DRAW);
+    glGenBuffers(1, &mesh.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned short), &mesh.indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// initInstancing: Verifica o suporte do contexto e prepara o shader e os buffers.
+void initInstancing() {
+    instancingAvailable = false;
+#if !defined(__APPLE_CC__)
+    if (rendererBackend == RENDERER_SHADER) { // O programa da cena já entende instâncias
+        if (!useInstancing) return;
+        glGenBuffers(1, &instanceBuffer);
+        instancingAvailable = true;
+        return;
+    }
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!useInstancing || !version || atof(version) < 3.3) return;
+
+    GLuint vs = compileShader(GL_VERTEX_SHADER, INSTANCE_VERTEX_SHADER);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, INSTANCE_FRAGMENT_SHADER);
+    if (!vs || !fs) return;
+    instanceProgram = glCreateProgram();
+    glAttachShader(instanceProgram, vs);
+    glAttachShader(instanceProgram, fs);
+    glBindAttribLocation(instanceProgram, INSTANCE_ATTRIB, "instanceData");
+    glLinkProgram(instanceProgram);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = GL_FALSE;
+    glGetProgramiv(instanceProgram, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        fprintf(stderr, "Erro ao ligar o programa de instancias, usando o caminho por objeto\n");
+        glDeleteProgram(instanceProgram);
+        return;
+    }
+    instanceKindLocation = glGetUniformLocation(instanceProgram, "instanceKind");
+
+    for (int lod = 0; lod < NUM_LODS; ++lod) uploadMeshBuffers(fishModelMeshes[lod]);
+    uploadMeshBuffers(diskMesh);
+    glGenBuffers(1, &instanceBuffer);
+    instancingAvailable = true;
+#endif
+}
+
+// drawMeshInstanced: Desenha count cópias da malha, uma por vec4 em instances.
+void drawMeshInstanced(const Mesh& mesh, int kind, const float* instances, int count) {
+#if !defined(__APPLE_CC__)
+    if (rendererBackend == RENDERER_SHADER) {
+        float modelview[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+        setSceneMatrices(modelview);
+        glUniform1i(sceneInstanceKindLocation, kind);
+        glBindVertexArray(mesh.vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, count * 4 * sizeof(float), instances, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(INSTANCE_ATTRIB);
+        glVertexAttribPointer(INSTANCE_ATTRIB, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribDivisor(INSTANCE_ATTRIB, 1);
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, 0, count);
+        currentFrame.drawCalls++;
+        glDisableVertexAttribArray(INSTANCE_ATTRIB); // A mesma malha também sai sem instâncias
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glUniform1i(sceneInstanceKindLocation, INSTANCE_NONE);
+        return;
+    }
+    glUseProgram(instanceProgram);
+    glUniform1i(instanceKindLocation, kind);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer);
+    glNormalPointer(GL_FLOAT, 0, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, count * 4 * sizeof(float), instances, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(INSTANCE_ATTRIB);
+    glVertexAttribPointer(INSTANCE_ATTRIB, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribDivisor(INSTANCE_ATTRIB, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, 0, count);
+    currentFrame.drawCalls++;
+
+    glVertexAttribDivisor(INSTANCE_ATTRIB, 0);
+    glDisableVertexAttribArray(INSTANCE_ATTRIB);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glUseProgram(0);
+    stateCache.program = 0;
+#endif
+}
+
+// drawFishInstanced: Junta a transformação dos peixes visíveis, separados por nível de
+// detalhe, e desenha cada nível de uma vez.
+void drawFishInstanced(const FishPool& fishes) {
+    PROFILE_SCOPE(PROFILE_DRAW_FISH);
+    if (fishes.count == 0) return;
+    for (int lod = 0; lod < NUM_LODS; ++lod) lodInstanceData[lod].clear();
+    for (int i = 0; i < fishes.count; ++i) {
+        float y = fishes.columns[FISH_Y][i] + fishBobOffsets[i];
+        int lod = cullEntity(fishes.columns[FISH_X][i], y, fishes.columns[FISH_Z][i], FISH_BOUND_RADIUS);
+        if (lod < 0) continue;
+        FrameArray<float>& data = lodInstanceData[lod];
+        data.push_back(fishes.columns[FISH_X][i]);
+        data.push_back(y);
+        data.push_back(fishes.columns[FISH_Z][i]);
+        data.push_back(fishYaws[i]);
+    }
+    setMaterial(1.0f, 0.3f, 0.0f, 80.0f);
+    for (int lod = 0; lod < NUM_LODS; ++lod) {
+        int count = lodInstanceData[lod].size() / 4;
+        if (count > 0) drawMeshInstanced(fishModelMeshes[lod], INSTANCE_FISH, lodInstanceData[lod].items, count);
+    }
+}
+
+// drawHolesInstanced: Junta a posição e o raio dos buracos visíveis e os desenha de uma vez.
+void drawHolesInstanced(const HolePool& holes) {
+    PROFILE_SCOPE(PROFILE_DRAW_HOLE);
+    instanceData.clear();
+    for (int i = 0; i < holes.count; ++i) {
+        if (cullEntity(holes.columns[HOLE_X][i], holes.columns[HOLE_Y][i], holes.columns[HOLE_Z][i],
+                       holes.columns[HOLE_RADIUS][i]) < 0) continue;
+        instanceData.push_back(holes.columns[HOLE_X][i]);
+        instanceData.push_back(holes.columns[HOLE_Y][i]);
+        instanceData.push_back(holes.columns[HOLE_Z][i]);
+        instanceData.push_back(holes.columns[HOLE_RADIUS][i]);
+    }
+    if (instanceData.empty()) return;
+    setMaterial(0.0f, 0.2f, 0.4f, 10.0f);
+    drawMeshInstanced(diskMesh, INSTANCE_HOLE, instanceData.items, instanceData.size() / 4);
+}
+
+// ===================================================================
+// BACKEND DE SHADERS
+//
+// Com --renderer shader, todo o desenho 3D passa por um único programa GLSL
+// 3.30: as malhas saem de vertex array objects em vez de display lists, as
+// luzes, a projeção e a névoa vão num uniform buffer atualizado uma vez por
+// quadro, e o material vira quatro uniforms. As matrizes continuam vindo da
+// pilha do OpenGL, capturadas por comando como no pipeline fixo, então os
+// dois backends desenham a mesma cena com a mesma fila.
+// ===================================================================
+
+const char* SCENE_VERTEX_SHADER =
+    "#version 330 core\n"
+    "layout(std140) uniform FrameData {\n"
+    "    mat4 projection;\n"
+    "    vec4 lightPosition[2];\n"
+    "    vec4 lightAmbient[2];\n"
+    "    vec4 lightDiffuse[2];\n"
+    "    vec4 lightSpecular[2];\n"
+    "    vec4 sceneAmbient;\n"
+    "    vec4 fogColor;\n"
+    "    vec4 fogRange;\n"
+    "};\n"
+    "uniform mat4 modelView;\n"
+    "uniform mat3 normalMatrix;\n"
+    "uniform vec4 materialAmbient, materialDiffuse, materialSpecular;\n"
+    "uniform float materialShininess;\n"
+    "uniform int instanceKind;\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec3 normal;\n"
+    "layout(location = 2) in vec3 vertexColor;\n"
+    "layout(location = 6) in vec4 instanceData;\n"
+    "out vec4 color;\n"
+    "out float fogDepth;\n"
+    "void main() {\n"
+    "    vec3 p = position;\n"
+    "    vec3 n = normal;\n"
+    "    if (instanceKind == 0) {\n"
+    "        // Peixe: xyz = posição já com o balanço, w = giro em graus\n"
+    "        float a = radians(instanceData.w);\n"
+    "        float c = cos(a), s = sin(a);\n"
+    "        p = vec3(c * p.x + s * p.z, p.y, -s * p.x + c * p.z) + instanceData.xyz;\n"
+    "        n = vec3(c * n.x + s * n.z, n.y, -s * n.x + c * n.z);\n"
+    "    } else if (instanceKind == 1) {\n"
+    "        // Buraco: xyz = posição, w = raio\n"
+    "        p = vec3(p.x * instanceData.w, p.y + 0.02, p.z * instanceData.w) + instanceData.xyz;\n"
+    "    }\n"
+    "    vec4 eyePos = modelView * vec4(p, 1.0);\n"
+    "    if (instanceKind == 2) {\n"
+    "        color = vec4(vertexColor, 1.0);\n"
+    "    } else {\n"
+    "        vec3 N = normalize(normalMatrix * n);\n"
+    "        vec4 c = sceneAmbient * materialAmbient;\n"
+    "        for (int i = 0; i < 2; ++i) {\n"
+    "            vec3 L = normalize(lightPosition[i].xyz - eyePos.xyz);\n"
+    "            float NdotL = max(dot(N, L), 0.0);\n"
+    "            c += lightAmbient[i] * materialAmbient + lightDiffuse[i] * materialDiffuse * NdotL;\n"
+    "            if (NdotL > 0.0) {\n"
+    "                vec3 H = normalize(L + vec3(0.0, 0.0, 1.0));\n"
+    "                c += lightSpecular[i] * materialSpecular * pow(max(dot(N, H), 0.0), materialShininess);\n"
+    "            }\n"
+    "        }\n"
+    "        color = vec4(clamp(c.rgb, 0.0, 1.0), materialDiffuse.a);\n"
+    "    }\n"
+    "    fogDepth = abs(eyePos.z);\n"
+    "    gl_Position = projection * eyePos;\n"
+    "}\n";
+
+const char* SCENE_FRAGMENT_SHADER =
+    "#version 330 core\n"
+    "layout(std140) uniform FrameData {\n"
+    "    mat4 projection;\n"
+    "    vec4 lightPosition[2];\n"
+    "    vec4 lightAmbient[2];\n"
+    "    vec4 lightDiffuse[2];\n"
+    "    vec4 lightSpecular[2];\n"
+    "    vec4 sceneAmbient;\n"
+    "    vec4 fogColor;\n"
+    "    vec4 fogRange;\n"
+    "};\n"
+    "in vec4 color;\n"
+    "in float fogDepth;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    float f = clamp((fogRange.y - fogDepth) / (fogRange.y - fogRange.x), 0.0, 1.0);\n"
+    "    fragColor = vec4(mix(fogColor.rgb, color.rgb, f), color.a);\n"
+    "}\n";
+
+// normalMatrixOf: Inversa transposta do bloco 3x3 da modelview (colunas, como o GLSL).
+void normalMatrixOf(const float* m, float* n) {
+    // a(r, c) = m[c * 4 + r]; o cofator de (r, c) sai do produto cíclico das outras linhas
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            int r1 = (r + 1) % 3, r2 = (r + 2) % 3, c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            n[c * 3 + r] = m[c1 * 4 + r1] * m[c2 * 4 + r2] - m[c2 * 4 + r1] * m[c1 * 4 + r2];
         }
+    }
+    float det = m[0] * n[0] + m[4] * n[3] + m[8] * n[6];
+    if (det == 0.0f) return;
+    for (int i = 0; i < 9; ++i) n[i] /= det;
+}
+
+// setSceneMatrices: Ativa o programa da cena e envia a modelview e a matriz das normais.
+void setSceneMatrices(const float* modelview) {
+#if !defined(__APPLE_CC__)
+    float normalMatrix[9];
+    normalMatrixOf(modelview, normalMatrix);
+    setProgram(sceneProgram);
+    glUniformMatrix4fv(sceneModelViewLocation, 1, GL_FALSE, modelview);
+    glUniformMatrix3fv(sceneNormalMatrixLocation, 1, GL_FALSE, normalMatrix);
+#endif
+}
+
+// updateFrameUniforms: Envia a projeção, as luzes e a névoa do quadro ao uniform buffer.
+void updateFrameUniforms() {
+#if !defined(__APPLE_CC__)
+    FrameUniforms frame;
+    glGetFloatv(GL_PROJECTION_MATRIX, frame.projection);
+    // As luzes são posicionadas com a modelview identidade, então já estão no espaço do olho
+    memcpy(frame.lightPosition[0], SUN_POSITION, sizeof(frame.lightPosition[0]));
+    memcpy(frame.lightAmbient[0], SUN_AMBIENT, sizeof(frame.lightAmbient[0]));
+    memcpy(frame.lightDiffuse[0], SUN_DIFFUSE, sizeof(frame.lightDiffuse[0]));
+    memcpy(frame.lightSpecular[0], SUN_SPECULAR, sizeof(frame.lightSpecular[0]));
+    memcpy(frame.lightPosition[1], FILL_POSITION, sizeof(frame.lightPosition[1]));
+    memcpy(frame.lightAmbient[1], FILL_AMBIENT, sizeof(frame.lightAmbient[1]));
+    memcpy(frame.lightDiffuse[1], FILL_DIFFUSE, sizeof(frame.lightDiffuse[1]));
+    memcpy(frame.lightSpecular[1], FILL_SPECULAR, sizeof(frame.lightSpecular[1]));
+    memcpy(frame.sceneAmbient, SCENE_AMBIENT, sizeof(frame.sceneAmbient));
+    memcpy(frame.fogColor, FOG_COLOR, sizeof(frame.fogColor));
+    frame.fogRange[0] = FOG_START;
+    frame.fogRange[1] = FOG_END;
+    frame.fogRange[2] = frame.fogRange[3] = 0.0f;
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameUniformBuffer);
+#endif
+}
+
+// buildMeshVertexArray: Carrega a malha na GPU e grava seus atributos num vertex array.
+void buildMeshVertexArray(Mesh& mesh) {
+#if !defined(__APPLE_CC__)
+    uploadMeshBuffers(mesh);
+    glGenVertexArrays(1, &mesh.vertexArray);
+    glBindVertexArray(mesh.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer); // Fica gravado no vertex array
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
+}
+
+// addSkyQuad: Acrescenta os dois triângulos de um quad do céu (posição e cor intercaladas).
+void addSkyQuad(std::vector<float>& data, const float quad[4][3], const GLfloat* color) {
+    const int order[6] = {0, 1, 2, 0, 2, 3};
+    for (int i = 0; i < 6; ++i) {
+        data.insert(data.end(), quad[order[i]], quad[order[i]] + 3);
+        data.insert(data.end(), color, color + 3);
+    }
+}
+
+// buildSkyboxVertexArray: Monta o céu de drawSkybox como triângulos num vertex array.
+void buildSkyboxVertexArray() {
+#if !defined(__APPLE_CC__)
+    float size = SKYBOX_SIZE;
+    float height = SKYBOX_HEIGHT;
+    float bottom = SKYBOX_BOTTOM;
+    const float quads[5][4][3] = {
+        {{-size, bottom, -size}, {size, bottom, -size}, {size, height, -size}, {-size, height, -size}}, // Frente
+        {{size, bottom, size}, {-size, bottom, size}, {-size, height, size}, {size, height, size}},     // Trás
+        {{-size, bottom, size}, {-size, bottom, -size}, {-size, height, -size}, {-size, height, size}}, // Esquerda
+        {{size, bottom, -size}, {size, bottom, size}, {size, height, size}, {size, height, -size}},     // Direita
+        {{-size, height, -size}, {size, height, -size}, {size, height, size}, {-size, height, size}}    // Topo
+    };
+    std::vector<float> data;
+    for (int i = 0; i < 5; ++i) addSkyQuad(data, quads[i], i < 4 ? SKY_SIDE_COLOR : SKY_TOP_COLOR);
+    skyboxVertexCount = data.size() / 6;
+
+    glGenVertexArrays(1, &skyboxVertexArray);
+    glBindVertexArray(skyboxVertexArray);
+    glGenBuffers(1, &skyboxBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxBuffer);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 0);
+    glEnableVertexAttribArray(COLOR_ATTRIB);
+    glVertexAttribPointer(COLOR_ATTRIB, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (const void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
+// initShaderBackend: Compila o programa da cena e passa todas as malhas para vertex
+// arrays. Retorna falso se o contexto não oferece OpenGL 3.3.
+bool initShaderBackend() {
+#if !defined(__APPLE_CC__)
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!version || atof(version) < 3.3) return false;
+
+    GLuint vs = compileShader(GL_VERTEX_SHADER, SCENE_VERTEX_SHADER);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, SCENE_FRAGMENT_SHADER);
+    if (!vs || !fs) return false;
+    sceneProgram = glCreateProgram();
+    glAttachShader(sceneProgram, vs);
+    glAttachShader(sceneProgram, fs);
+    glLinkProgram(sceneProgram);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = GL_FALSE;
+    glGetProgramiv(sceneProgram, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        fprintf(stderr, "Erro ao ligar o programa da cena\n");
+        glDeleteProgram(sceneProgram);
+        return false;
+    }
+    sceneModelViewLocation = glGetUniformLocation(sceneProgram, "modelView");
+    sceneNormalMatrixLocation = glGetUniformLocation(sceneProgram, "normalMatrix");
+    sceneInstanceKindLocation = glGetUniformLocation(sceneProgram, "instanceKind");
+    sceneMaterialLocations[0] = glGetUniformLocation(sceneProgram, "materialAmbient");
+    sceneMaterialLocations[1] = glGetUniformLocation(sceneProgram, "materialDiffuse");
+    sceneMaterialLocations[2] = glGetUniformLocation(sceneProgram, "materialSpecular");
+    sceneMaterialLocations[3] = glGetUniformLocation(sceneProgram, "materialShininess");
+    glUniformBlockBinding(sceneProgram, glGetUniformBlockIndex(sceneProgram, "FrameData"), FRAME_UNIFORM_BINDING);
+
+    glGenBuffers(1, &frameUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    for (int lod = 0; lod < NUM_LODS; ++lod) {
+        buildMeshVertexArray(sphereMeshes[lod]);
+        buildMeshVertexArray(tailMeshes[lod]);
+        buildMeshVertexArray(fishModelMeshes[lod]);
+    }
+    Mesh* meshes[] = {&eyeMesh, &beakMesh, &diskMesh, &cubeMesh};
+    for (int i = 0; i < 4; ++i) buildMeshVertexArray(*meshes[i]);
+    buildSkyboxVertexArray();
 
-        // Verifica colisões
-        for (int i = 0; i < holes.size(); ++i) {
-            if (holes[i].active && checkCollision(motherPenguin.pos, 0.3f, holes[i].pos, holes[i].radius)) {
-                gameState = 2; // Derrota
+    glUseProgram(sceneProgram);
+    glUniform1i(sceneInstanceKindLocation, INSTANCE_NONE);
+    glUseProgram(0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ===================================================================
+// TEXTO DA INTERFACE
+//
+// Os glifos da fonte embutida vão para uma única textura. Cada TextLabel
+// guarda os quads do seu texto e só é remontado quando os valores exibidos
+// mudam; desenhar um texto é uma chamada com vertex arrays, em vez de uma
+// operação de raster por caractere como glutBitmapCharacter.
+// ===================================================================
+
+// buildFontAtlas: Expande a fonte bitmap numa textura alfa com todos os glifos.
+void buildFontAtlas() {
+    std::vector<unsigned char> pixels(FONT_ATLAS_SIZE * FONT_ATLAS_SIZE, 0);
+    for (int g = 0; g < FONT_NUM_CHARS; ++g) {
+        int x0 = (g % FONT_ATLAS_COLUMNS) * FONT_CELL_WIDTH;
+        int y0 = (g / FONT_ATLAS_COLUMNS) * FONT_CELL_HEIGHT;
+        for (int r = 0; r < FONT_CELL_HEIGHT; ++r) {
+            for (int c = 0; c < FONT_CELL_WIDTH; ++c) {
+                if (FONT_GLYPHS[g][r] & (0x80 >> c)) pixels[(y0 + r) * FONT_ATLAS_SIZE + x0 + c] = 255;
             }
         }
-        if (!motherPenguin.hasFish) {
-            for (int i = 0; i < fishes.size(); ++i) {
-                if (fishes[i].active && checkCollision(motherPenguin.pos, 0.4f, fishes[i].pos, 0.2f)) {
-                    fishes[i].active = false;
-                    motherPenguin.hasFish = true;
-                    break;
-                }
-            }
+    }
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, &pixels[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// labelChanged: Compara os valores exibidos com os do texto atual e guarda os novos.
+// Retorna true quando o texto precisa ser remontado.
+bool labelChanged(TextLabel& label, const int* key, int count) {
+    if (label.keyCount == count && memcmp(label.key, key, count * sizeof(int)) == 0) return false;
+    memcpy(label.key, key, count * sizeof(int));
+    label.keyCount = count;
+    return true;
+}
+
+// layoutLabel: Monta os quads do texto, com a origem no canto inferior esquerdo.
+void layoutLabel(TextLabel& label, const char* text) {
+    label.vertices.clear();
+    const float texel = 1.0f / FONT_ATLAS_SIZE;
+    for (int i = 0; text[i] != '\0'; ++i) {
+        int g = (unsigned char)text[i] - FONT_FIRST_CHAR;
+        if (g <= 0 || g >= FONT_NUM_CHARS) continue; // Espaço ou fora da fonte
+        float x = i * FONT_CELL_WIDTH;
+        float u0 = (g % FONT_ATLAS_COLUMNS) * FONT_CELL_WIDTH * texel;
+        float v0 = (g / FONT_ATLAS_COLUMNS) * FONT_CELL_HEIGHT * texel; // Topo do glifo
+        float u1 = u0 + FONT_CELL_WIDTH * texel;
+        float v1 = v0 + FONT_CELL_HEIGHT * texel;
+        float quad[16] = {
+            x, 0.0f, u0, v1,
+            x + FONT_CELL_WIDTH, 0.0f, u1, v1,
+            x + FONT_CELL_WIDTH, (float)FONT_CELL_HEIGHT, u1, v0,
+            x, (float)FONT_CELL_HEIGHT, u0, v0
+        };
+        label.vertices.insert(label.vertices.end(), quad, quad + 16);
+    }
+    currentFrame.textLayouts++;
+}
+
+// drawLabel: Desenha um texto já montado na posição (x, y) da projeção do drawUI.
+void drawLabel(const TextLabel& label, float x, float y, float scale) {
+    if (label.vertices.empty()) return;
+    glPushMatrix();
+    glTranslatef(x, y, 0.0f);
+    glScalef(scale, scale, 1.0f);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), &label.vertices[0]);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), &label.vertices[2]);
+    glDrawArrays(GL_QUADS, 0, label.vertices.size() / 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glPopMatrix();
+    currentFrame.drawCalls++;
+}
+
+// ===================================================================
+// RECORTE POR FRUSTUM E NÍVEL DE DETALHE
+//
+// Cada pinguim, peixe e buraco é testado com uma esfera envolvente contra os
+// seis planos do volume de visão. Os que passam escolhem o nível de detalhe
+// pelo raio projetado na tela: o modelo mais fino só aparece de perto.
+// ===================================================================
+
+// updateViewFrustum: Extrai os planos e a posição da câmera das matrizes atuais.
+void updateViewFrustum(int viewportHeight) {
+    float proj[16], view[16], clip[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, proj);
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            clip[c * 4 + r] = proj[0 * 4 + r] * view[c * 4 + 0] + proj[1 * 4 + r] * view[c * 4 + 1]
+                            + proj[2 * 4 + r] * view[c * 4 + 2] + proj[3 * 4 + r] * view[c * 4 + 3];
         }
-        if (motherPenguin.hasFish && checkCollision(motherPenguin.pos, 0.5f, babyPenguin.pos, 0.3f)) {
-            motherPenguin.hasFish = false;
-            babyEnergyTime = BABY_ENERGY_MAX;
+    }
+    // Esquerda, direita, baixo, cima, perto e longe: linha 3 somada ou subtraída das linhas 0, 1 e 2
+    for (int p = 0; p < 6; ++p) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        float* plane = viewFrustum.planes[p];
+        for (int c = 0; c < 4; ++c) plane[c] = clip[c * 4 + 3] + sign * clip[c * 4 + row];
+        float len = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (int c = 0; c < 4; ++c) plane[c] /= len;
+    }
+    // Câmera = -R^T * t, com R e t da matriz de visão
+    for (int i = 0; i < 3; ++i) {
+        viewFrustum.eye[i] = -(view[i * 4 + 0] * view[12] + view[i * 4 + 1] * view[13] + view[i * 4 + 2] * view[14]);
+    }
+    viewFrustum.pixelScale = viewportHeight * 0.5f * proj[5];
+}
+
+// cullEntity: Testa a esfera (x, y, z, radius) e conta o resultado no quadro atual.
+// Retorna -1 se ela está fora do volume de visão, ou o nível de detalhe a usar.
+int cullEntity(float x, float y, float z, float radius) {
+    if (cullingEnabled) {
+        for (int p = 0; p < 6; ++p) {
+            const float* plane = viewFrustum.planes[p];
+            if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -radius) {
+                currentFrame.entitiesCulled++;
+                return -1;
+            }
         }
+    }
+    int lod = 0;
+    if (lodEnabled) {
+        float dx = x - viewFrustum.eye[0], dy = y - viewFrustum.eye[1], dz = z - viewFrustum.eye[2];
+        float distance = sqrt(dx * dx + dy * dy + dz * dz);
+        float pixels = distance > radius ? radius * viewFrustum.pixelScale / distance : LOD_MIN_PIXELS[0];
+        while (lod < NUM_LODS - 1 && pixels < LOD_MIN_PIXELS[lod]) lod++;
+    }
+    currentFrame.entitiesDrawn++;
+    currentFrame.lodCounts[lod]++;
+    return lod;
+}
+
+// ===================================================================
+// PROFILER DE QUADRO
+//
+// As amostras vão para um anel sem trava: cada escritor reserva um índice com
+// fetch_add e publica o slot gravando sequence por último. Quem lê (HUD e
+// exportação) descarta slots cuja sequence não bate com o índice esperado,
+// o que acontece se o slot estiver sendo sobrescrito no mesmo instante.
+// ===================================================================
+
+// profileNowNs: Relógio monotônico em nanossegundos.
+long long profileNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// profileThreadIndex: Número da thread no trace, dado na primeira chamada de cada thread.
+int profileThreadIndex() {
+    static thread_local int thread = profileThreadCount.fetch_add(1);
+    return thread;
+}
+
+// profileRecord: Publica uma amostra no anel e soma sua duração no quadro atual.
+void profileRecord(int zone, long long startNs, long long durationNs) {
+    int thread = profileThreadIndex();
+    unsigned long long index = profileWriteIndex.fetch_add(1, std::memory_order_relaxed);
+    ProfileSample& s = profileRing[index & (PROFILE_RING_SIZE - 1)];
+    s.sequence.store(0, std::memory_order_relaxed);
+    s.startNs = startNs;
+    s.durationNs = durationNs;
+    s.zone = zone;
+    s.thread = thread;
+    s.sequence.store(index + 1, std::memory_order_release);
+    profileZoneFrameNs[zone].fetch_add(durationNs, std::memory_order_relaxed);
+}
+
+// profileEndFrame: Move as somas do quadro atual para o histórico do HUD. Com a thread da
+// simulação, os passos dados por ela desde o último quadro entram no quadro que os recolhe.
+void profileEndFrame() {
+    for (int z = 0; z < PROFILE_NUM_ZONES; ++z) {
+        profileZoneHistory[profileHistoryFrame][z] = profileZoneFrameNs[z].exchange(0, std::memory_order_relaxed) / 1.0e6;
+    }
+    profileHistoryFrame = (profileHistoryFrame + 1) % PROFILE_HUD_FRAMES;
+}
 
-        // Controla a geração de objetos
-        fishSpawnTimer += deltaTime;
-        if (fishSpawnTimer >= 5.0f) {
-            spawnFish();
-            fishSpawnTimer = 0.0f;
+// drawProfilerHud: Gráfico de barras empilhadas com o tempo de cada zona nos
+// últimos quadros, mais a legenda com as médias. Espera a projeção ortográfica do drawUI.
+void drawProfilerHud(int windowWidth, int windowHeight) {
+    static const float colors[PROFILE_NUM_ZONES][3] = {
+        {0.9f, 0.2f, 0.2f}, {1.0f, 0.6f, 0.2f}, {1.0f, 0.9f, 0.2f}, {0.2f, 0.4f, 0.9f},
+        {0.5f, 0.8f, 1.0f}, {0.8f, 0.8f, 0.8f}, {0.2f, 0.8f, 0.3f}, {1.0f, 0.4f, 0.7f},
+        {0.1f, 0.3f, 0.5f}, {0.6f, 0.3f, 0.9f}, {1.0f, 1.0f, 1.0f}, {0.4f, 0.4f, 0.4f},
+        {0.3f, 0.9f, 0.9f}, {0.9f, 0.9f, 0.5f}, {0.6f, 0.9f, 0.3f}
+    };
+    // Só as zonas que não estão aninhadas em outras entram na pilha
+    static const int stacked[] = {PROFILE_SIM_STEP, PROFILE_DRAW_SCENE, PROFILE_DRAW_UI, PROFILE_SWAP};
+    const float pixelsPerMs = 3.0f;
+    const float barWidth = 3.0f;
+    float x0 = windowWidth - PROFILE_HUD_FRAMES * barWidth - 10.0f;
+    float y0 = 10.0f;
+
+    // Linha de referência em 16.7 ms (60 Hz)
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBegin(GL_LINES);
+    glVertex2f(x0, y0 + 16.7f * pixelsPerMs);
+    glVertex2f(x0 + PROFILE_HUD_FRAMES * barWidth, y0 + 16.7f * pixelsPerMs);
+    glEnd();
+
+    glBegin(GL_QUADS);
+    for (int f = 0; f < PROFILE_HUD_FRAMES; ++f) {
+        const double* frame = profileZoneHistory[(profileHistoryFrame + f) % PROFILE_HUD_FRAMES];
+        float x = x0 + f * barWidth;
+        float y = y0;
+        for (int k = 0; k < 4; ++k) {
+            int z = stacked[k];
+            float h = frame[z] * pixelsPerMs;
+            glColor3fv(colors[z]);
+            glVertex2f(x, y); glVertex2f(x + barWidth - 1, y);
+            glVertex2f(x + barWidth - 1, y + h); glVertex2f(x, y + h);
+            y += h;
         }
-        holeSpawnTimer += deltaTime;
-        if (holeSpawnTimer >= 8.0f) {
-            spawnHole();
-            holeSpawnTimer = 0.0f;
+    }
+    glEnd();
+
+    // Legenda com a média de cada zona nos quadros do histórico, remontada só
+    // quando o valor exibido (em centésimos de ms) muda
+    static TextLabel legend[PROFILE_NUM_ZONES];
+    for (int z = 0; z < PROFILE_NUM_ZONES; ++z) {
+        double sum = 0.0;
+        for (int f = 0; f < PROFILE_HUD_FRAMES; ++f) sum += profileZoneHistory[f][z];
+        int hundredths = (int)(sum * 100.0 / PROFILE_HUD_FRAMES + 0.5);
+        if (labelChanged(legend[z], &hundredths, 1)) {
+            char line[64];
+            sprintf(line, "%-16s %3d.%02d ms", PROFILE_ZONE_NAMES[z], hundredths / 100, hundredths % 100);
+            layoutLabel(legend[z], line);
         }
+        glColor3fv(colors[z]);
+        drawLabel(legend[z], x0, windowHeight - 64 - z * 16, 1.0f);
     }
+}
 
-    glutPostRedisplay();
-    glutTimerFunc(16, timer, 0);
+// writeProfile: Grava as amostras do anel em formato Chrome trace_event (.json) ou CSV.
+void writeProfile() {
+    if (!profileOutputPath) return;
+    FILE* f = fopen(profileOutputPath, "w");
+    if (!f) { perror(profileOutputPath); return; }
+
+    size_t len = strlen(profileOutputPath);
+    bool csv = len >= 4 && strcmp(profileOutputPath + len - 4, ".csv") == 0;
+    unsigned long long end = profileWriteIndex.load(std::memory_order_acquire);
+    unsigned long long begin = end > PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+
+    if (csv) fprintf(f, "zone,thread,start_us,duration_us\n");
+    else fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (unsigned long long i = begin; i < end; ++i) {
+        const ProfileSample& s = profileRing[i & (PROFILE_RING_SIZE - 1)];
+        if (s.sequence.load(std::memory_order_acquire) != i + 1) continue; // Slot incompleto
+        if (csv) {
+            fprintf(f, "%s,%d,%.3f,%.3f\n", PROFILE_ZONE_NAMES[s.zone], s.thread,
+                    s.startNs / 1000.0, s.durationNs / 1000.0);
+        } else {
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", PROFILE_ZONE_NAMES[s.zone], s.thread,
+                    s.startNs / 1000.0, s.durationNs / 1000.0);
+        }
+        first = false;
+    }
+    if (!csv) fprintf(f, "\n]}\n");
+    fclose(f);
 }
 
 // ===================================================================
-// TRATAMENTO DE ENTRADA
+// FILA DE DESENHO E CACHE DE ESTADO
+//
+// As funções draw* não falam mais diretamente com o OpenGL: setMaterial só
+// escolhe o material corrente e submitMesh grava um comando com a matriz
+// atual. No fim, flushRenderQueue ordena os comandos por camada e material
+// e os envia passando por um cache do estado do OpenGL, que descarta
+// chamadas que não mudariam nada.
 // ===================================================================
 
-// reshape: Chamada quando a janela é redimensionada.
-void reshape(int w, int h) {
-    if (h == 0) h = 1;
-    glViewport(0, 0, w, h);
+// internMaterial: Retorna o identificador do material, cadastrando-o se for novo.
+int internMaterial(const Material& m) {
+    for (int i = 0; i < (int)materials.size(); ++i) {
+        if (memcmp(&materials[i], &m, sizeof(Material)) == 0) return i;
+    }
+    materials.push_back(m);
+    return materials.size() - 1;
 }
 
-// keyboard: Trata os pressionamentos de teclas normais.
-void keyboard(unsigned char key, int x, int y) {
-    if (key == 27) exit(0); // ESC para sair
-    if (key == 'r' || key == 'R') resetGame();
+// makeMaterial: Monta o material padrão do jogo a partir de uma cor base.
+Material makeMaterial(float r, float g, float b, float shininess) {
+    Material m = {
+        {r * 0.3f, g * 0.3f, b * 0.3f, 1.0f},
+        {r, g, b, 1.0f},
+        {0.8f, 0.8f, 0.8f, 1.0f},
+        shininess
+    };
+    return m;
+}
 
-    // Adiciona o switch para trocar a câmera
-    switch(key) {
-        case '1':
-            cameraSelected = 1;
-            break;
-        case '2':
-            cameraSelected = 2;
-            break;
-        case '3':
-            cameraSelected = 3;
-            break;
-        case '4':
-            cameraSelected = 4;
-            break;
+// invalidateStateCache: Esquece o estado conhecido (depois de mudanças fora do cache).
+void invalidateStateCache() {
+    stateCache.material = stateCache.program = -1;
+    stateCache.lighting = stateCache.depthTest = stateCache.depthMask = -1;
+}
+
+// applyMaterial: Envia o material ao OpenGL, a menos que ele já esteja ativo.
+void applyMaterial(int id) {
+    if (stateCache.material == id) {
+        currentFrame.stateSkipped += 4;
+        return;
+    }
+    const Material& m = materials[id];
+    if (rendererBackend == RENDERER_SHADER) {
+        setProgram(sceneProgram);
+        glUniform4fv(sceneMaterialLocations[0], 1, m.ambient);
+        glUniform4fv(sceneMaterialLocations[1], 1, m.diffuse);
+        glUniform4fv(sceneMaterialLocations[2], 1, m.specular);
+        glUniform1f(sceneMaterialLocations[3], m.shininess);
+        stateCache.material = id;
+        currentFrame.stateIssued += 4;
+        return;
     }
+    glMaterialfv(GL_FRONT, GL_AMBIENT, m.ambient);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, m.diffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, m.specular);
+    glMaterialf(GL_FRONT, GL_SHININESS, m.shininess);
+    stateCache.material = id;
+    currentFrame.stateIssued += 4;
 }
 
-// special: Trata os pressionamentos de teclas especiais (ex: setas).
-void special(int key, int x, int y) {
-    if (gameState != 0) return;
+// setCachedFlag: Liga ou desliga um estado booleano, pulando chamadas redundantes.
+void setCachedFlag(int& cached, bool enabled, GLenum cap) {
+    if (cached == (int)enabled) {
+        currentFrame.stateSkipped++;
+        return;
+    }
+    if (cap == GL_DEPTH_WRITEMASK) glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    else if (enabled) glEnable(cap);
+    else glDisable(cap);
+    cached = enabled;
+    currentFrame.stateIssued++;
+}
 
-    float deltaTime = 16.0f / 1000.0f; // Delta time aproximado para input
-    float radians = motherPenguin.rotation * M_PI / 180.0f;
-    float dx = -sin(radians);
-    float dz = -cos(radians);
+void setLighting(bool enabled) { setCachedFlag(stateCache.lighting, enabled, GL_LIGHTING); }
+void setDepthTest(bool enabled) { setCachedFlag(stateCache.depthTest, enabled, GL_DEPTH_TEST); }
+void setDepthMask(bool enabled) { setCachedFlag(stateCache.depthMask, enabled, GL_DEPTH_WRITEMASK); }
+
+// setProgram: Ativa o programa de shaders (0 = pipeline fixo), pulando trocas redundantes.
+void setProgram(GLuint program) {
+    if (stateCache.program == (int)program) {
+        currentFrame.stateSkipped++;
+        return;
+    }
+    glUseProgram(program);
+    stateCache.program = program;
+    currentFrame.stateIssued++;
+}
 
-    motherPenguin.isMoving = true;
+// beginRenderQueue: Passa a gravar os desenhos em vez de enviá-los na hora.
+void beginRenderQueue() {
+    renderQueue.clear();
+    recordingQueue = true;
+}
 
-    switch (key) {
-        case GLUT_KEY_DOWN:
-            motherPenguin.pos.x += dx * PENGUIN_SPEED * deltaTime;
-            motherPenguin.pos.z += dz * PENGUIN_SPEED * deltaTime;
-            break;
-        case GLUT_KEY_UP:
-            motherPenguin.pos.x -= dx * PENGUIN_SPEED * deltaTime;
-            motherPenguin.pos.z -= dz * PENGUIN_SPEED * deltaTime;
-            break;
-        case GLUT_KEY_LEFT:
-            motherPenguin.rotation += ROTATION_SPEED * deltaTime;
-            break;
-        case GLUT_KEY_RIGHT:
-            motherPenguin.rotation -= ROTATION_SPEED * deltaTime;
-            break;
-        default:
-             motherPenguin.isMoving = false;
-             break;
+// drawMeshWithMatrix: Envia uma malha com a modelview dada, pelo backend ativo.
+void drawMeshWithMatrix(const Mesh& mesh, const float* modelview) {
+    if (rendererBackend == RENDERER_SHADER) {
+        setSceneMatrices(modelview);
+        glBindVertexArray(mesh.vertexArray);
+        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_SHORT, 0);
+    } else {
+        glLoadMatrixf(modelview);
+        glCallList(mesh.displayList);
     }
+    currentFrame.drawCalls++;
+}
 
-    // Limita a posição à plataforma
-    float halfPlatform = ICE_PLATFORM_SIZE / 2.0f - 0.3f;
-    if (motherPenguin.pos.x > halfPlatform) motherPenguin.pos.x = halfPlatform;
-    if (motherPenguin.pos.x < -halfPlatform) motherPenguin.pos.x = -halfPlatform;
-    if (motherPenguin.pos.z > halfPlatform) motherPenguin.pos.z = halfPlatform;
-    if (motherPenguin.pos.z < -halfPlatform) motherPenguin.pos.z = -halfPlatform;
+// submitMesh: Grava (ou, fora da fila, desenha) uma malha com o material corrente.
+void submitMesh(const Mesh& mesh) {
+    RenderCommand cmd;
+    if (!recordingQueue) {
+        applyMaterial(currentMaterial);
+        if (rendererBackend == RENDERER_SHADER) {
+            glGetFloatv(GL_MODELVIEW_MATRIX, cmd.modelview);
+            drawMeshWithMatrix(mesh, cmd.modelview);
+            glBindVertexArray(0);
+        } else {
+            glCallList(mesh.displayList);
+            currentFrame.drawCalls++;
+        }
+        return;
+    }
+    glGetFloatv(GL_MODELVIEW_MATRIX, cmd.modelview);
+    int layer = materials[currentMaterial].diffuse[3] < 1.0f ? 1 : 0; // Translúcidos por último
+    // A ordem de envio no fim da chave desempata como uma ordenação estável, sem o
+    // buffer temporário que std::stable_sort alocaria a cada quadro
+    cmd.sortKey = ((unsigned long long)((layer << 16) | currentMaterial) << 32) | (unsigned int)renderQueue.size();
+    cmd.material = currentMaterial;
+    cmd.mesh = &mesh;
+    renderQueue.push_back(cmd);
+}
+
+// compareCommands: Ordem de envio da fila (camada, depois material).
+bool compareCommands(const RenderCommand& a, const RenderCommand& b) {
+    return a.sortKey < b.sortKey;
+}
+
+// flushRenderQueue: Ordena e envia todos os comandos gravados.
+void flushRenderQueue() {
+    PROFILE_SCOPE(PROFILE_FLUSH_QUEUE);
+    recordingQueue = false;
+    std::sort(renderQueue.begin(), renderQueue.end(), compareCommands);
+
+    setLighting(true);
+    setDepthTest(true);
+    setDepthMask(true);
+    glPushMatrix();
+    for (int i = 0; i < (int)renderQueue.size(); ++i) {
+        const RenderCommand& cmd = renderQueue[i];
+        applyMaterial(cmd.material);
+        drawMeshWithMatrix(*cmd.mesh, cmd.modelview);
+    }
+    if (rendererBackend == RENDERER_SHADER) glBindVertexArray(0);
+    glPopMatrix();
 }
 
 // ===================================================================
 // FUNÇÕES AUXILIARES DE DESENHO
 // ===================================================================
 
-// setMaterial: Define as propriedades do material para um objeto.
+// setMaterial: Escolhe o material dos próximos desenhos. Dentro da fila ele só é
+// enviado ao OpenGL na hora do flush; fora dela, passa direto pelo cache de estado.
 void setMaterial(float r, float g, float b, float shininess = 50.0) {
-    GLfloat ambient[] = {r * 0.3f, g * 0.3f, b * 0.3f, 1.0f};
-    GLfloat diffuse[] = {r, g, b, 1.0f};
-    GLfloat specular[] = {0.8f, 0.8f, 0.8f, 1.0f};
-    glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
-    glMaterialf(GL_FRONT, GL_SHININESS, shininess);
+    currentMaterial = internMaterial(makeMaterial(r, g, b, shininess));
+    if (!recordingQueue) applyMaterial(currentMaterial);
 }
 
 // drawEllipsoid: Desenha um elipsoide sólido.
 void drawEllipsoid(float rx, float ry, float rz) {
     glPushMatrix();
     glScalef(rx, ry, rz);
-    glutSolidSphere(1.0, 20, 20);
+    drawMesh(sphereMeshes[currentLod]);
     glPopMatrix();
 }
 
 // drawPenguin: Desenha um modelo completo de pinguim.
 void drawPenguin(const Penguin& p) {
+    PROFILE_SCOPE(PROFILE_DRAW_PENGUIN);
+    currentLod = cullEntity(p.pos.x, p.pos.y, p.pos.z, PENGUIN_BOUND_RADIUS);
+    if (currentLod < 0) return;
     glPushMatrix();
     glTranslatef(p.pos.x, p.pos.y, p.pos.z);
     glRotatef(p.rotation, 0.0f, 1.0f, 0.0f);
@@ -572,14 +6620,16 @@ void drawPenguin(const Penguin& p) {
     setMaterial(0.95f, 0.95f, 0.95f);
     drawEllipsoid(0.12f, 0.14f, 0.12f);
     glPopMatrix();
-    setMaterial(0.0f, 0.0f, 0.0f); // Olhos
-    glPushMatrix(); glTranslatef(0.08f, 0.05f, 0.12f); glutSolidSphere(0.02, 10, 10); glPopMatrix();
-    glPushMatrix(); glTranslatef(-0.08f, 0.05f, 0.12f); glutSolidSphere(0.02, 10, 10); glPopMatrix();
+    if (currentLod < NUM_LODS - 1) { // Olhos, menores que um pixel no nível mais grosso
+        setMaterial(0.0f, 0.0f, 0.0f);
+        glPushMatrix(); glTranslatef(0.08f, 0.05f, 0.12f); glScalef(0.02f, 0.02f, 0.02f); drawMesh(eyeMesh); glPopMatrix();
+        glPushMatrix(); glTranslatef(-0.08f, 0.05f, 0.12f); glScalef(0.02f, 0.02f, 0.02f); drawMesh(eyeMesh); glPopMatrix();
+    }
     glPushMatrix(); // Bico
     glTranslatef(0.0f, -0.05f, 0.16f);
     setMaterial(1.0f, 0.6f, 0.0f);
     glRotatef(90.0, 1.0, 0.0, 0.0);
-    glutSolidCone(0.03, 0.08, 8, 4);
+    drawMesh(beakMesh);
     glPopMatrix();
     glPopMatrix();
 
@@ -619,41 +6669,39 @@ void drawPenguin(const Penguin& p) {
 
 // drawFish: Desenha um único modelo de peixe.
 void drawFish(const Fish& fish) {
-    if (!fish.active) return;
+    PROFILE_SCOPE(PROFILE_DRAW_FISH);
+    int lod = cullEntity(fish.pos.x, fish.pos.y + fish.bobOffset, fish.pos.z, FISH_BOUND_RADIUS);
+    if (lod < 0) return;
     glPushMatrix();
-    float currentY = fish.pos.y + sin(fish.animationTime * 2.0f) * fish.bobHeight;
-    glTranslatef(fish.pos.x, currentY, fish.pos.z);
-    glRotatef(sin(fish.animationTime * 0.5f) * 30.0f, 0.0f, 1.0f, 0.0f);
+    glTranslatef(fish.pos.x, fish.pos.y + fish.bobOffset, fish.pos.z);
+    glRotatef(fish.yaw, 0.0f, 1.0f, 0.0f);
 
     setMaterial(1.0f, 0.3f, 0.0f, 80.0f);
-    glPushMatrix();
-    glScalef(1.5, 1.5, 1.5); // Torna o peixe maior
-    drawEllipsoid(0.1f, 0.04f, 0.05f); // Corpo
-    glPushMatrix();
-    glTranslatef(-0.1f, 0.0f, 0.0f);
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
-    glutSolidCone(0.04f, 0.07f, 12, 8); // Cauda
-    glPopMatrix();
-    glPopMatrix();
+    submitMesh(fishModelMeshes[lod]);
 
     glPopMatrix();
 }
 
 // drawHole: Desenha um único buraco no gelo.
 void drawHole(const Hole& hole) {
-    if (!hole.active) return;
+    PROFILE_SCOPE(PROFILE_DRAW_HOLE);
+    if (cullEntity(hole.pos.x, hole.pos.y, hole.pos.z, hole.radius) < 0) return;
     glPushMatrix();
     glTranslatef(hole.pos.x, hole.pos.y, hole.pos.z);
 
     // Parte de água escura
     setMaterial(0.0f, 0.2f, 0.4f, 10.0f);
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0.0f, 1.0f, 0.0f);
-    glVertex3f(0.0f, 0.02f, 0.0f);
-    for (int i = 0; i <= 32; i++) {
-        float angle = i * 2.0f * M_PI / 32.0f;
-        glVertex3f(cos(angle) * hole.radius, 0.02f, sin(angle) * hole.radius);
-    }
-    glEnd();
+    glTranslatef(0.0f, 0.02f, 0.0f);
+    glScalef(hole.radius, 1.0f, hole.radius);
+    drawMesh(diskMesh);
     glPopMatrix();
 }
+
+// drawArenaPenguins: Desenha a mãe e o bebê de cada par da arena ainda em jogo.
+void drawArenaPenguins() {
+    for (int i = 0; i < arena.pairs.count; ++i) {
+        if (!arena.pairs.alive[i]) continue;
+        drawPenguin(arenaPenguin(arena, i, false));
+        drawPenguin(arenaPenguin(arena, i, true));
+    }
+}